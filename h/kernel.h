@@ -108,6 +108,7 @@ long sizmem();
 
 WORD *getstk(unsigned int nbytes);
 WORD *getmem(unsigned nbytes);
+WORD *getmemal(unsigned nbytes, unsigned align);
 SYSCALL	freemem(struct mblock *block, unsigned size);
 
 INTPROC	wakeup();
@@ -145,6 +146,7 @@ SYSCALL	setnok(int nok, int pid);
 SYSCALL screate(int count);
 SYSCALL signal(int sem);
 SYSCALL signaln(int sem, int count);
+SYSCALL signalnr(int sem, int count);
 SYSCALL	sleep(int n);
 SYSCALL	sleep10(int n);
 SYSCALL sleep100(int n);
@@ -0,0 +1,54 @@
+/* kmem.h - object caches for fixed-size kernel objects */
+
+#ifndef _KMEM_H_
+#define _KMEM_H_
+
+#ifndef	NKMCACHE
+#define	NKMCACHE	32		/* maximum number of caches	*/
+#endif
+#define	KMSLAB		4096		/* bytes a slab, unless larger	*/
+#define	KMMINOBJ	8		/*  to hold this many objects	*/
+#define	KMMAXALIGN	4096		/* largest alignment asked for	*/
+#define	KMMINSIZE	8		/* smallest object, padded	*/
+
+struct	kmslab	{			/* head of a slab from getmemal	*/
+	struct	kmcache	*sl_cache;	/* whose slab it is		*/
+	struct	kmslab	*sl_next;	/* the cache's other slabs	*/
+	unsigned long	sl_map[KMSLAB/KMMINSIZE/32]; /* free objects	*/
+};
+
+struct	kmstat	{			/* what kmem_cache_stats reports */
+	unsigned int	ks_size;	/* object size, padding included */
+	int	ks_slabs;
+	int	ks_total;		/* objects in those slabs	*/
+	int	ks_inuse;
+	int	ks_maxused;		/* most ever in use at once	*/
+	unsigned long	ks_allocs;
+	unsigned long	ks_frees;
+};
+
+struct	kmcache	{			/* one cache of same-size objects */
+	unsigned int	kc_size;	/* 0 if this entry is free	*/
+	unsigned int	kc_align;
+	unsigned int	kc_link;	/* where a free object's link is */
+	unsigned int	kc_slabsz;	/* bytes a slab, and its alignment */
+	unsigned int	kc_first;	/* offset of a slab's first object */
+	int	kc_perslab;		/* objects a slab		*/
+	void	(*kc_ctor)(void *);	/* run once on each new object	*/
+	char	*kc_free;		/* free objects			*/
+	struct	kmslab	*kc_slabs;
+	struct	kmstat	kc_stat;
+};
+
+extern	struct	kmcache	kmtab[];
+
+/* ANSI compliant function prototypes */
+
+int kmem_cache_create(unsigned int size, unsigned int align,
+		      void (*ctor)(void *));
+void *kmem_cache_alloc(int cid);
+int kmem_cache_free(int cid, void *obj);
+int kmem_cache_destroy(int cid);
+int kmem_cache_stats(int cid, struct kmstat *ksp);
+
+#endif
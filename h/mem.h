@@ -1,4 +1,4 @@
-/* mem.h - freestk, roundew, truncew , roundmb, truncmb */
+/* mem.h - freestk, roundew, truncew , roundmb, truncmb, mh_len */
 
 #ifndef _MEM_H_
 #define _MEM_H_
@@ -32,9 +32,46 @@ struct	mblock	{
 	struct	mblock	*mnext;
 	unsigned int	mlen;
 	};
-extern	struct	mblock	memlist;	/* head of free memory list	*/
+
+/*----------------------------------------------------------------------
+ *  the kernel heap: every block, free or in use, starts with a tag
+ *----------------------------------------------------------------------
+ */
+struct	mhead	{
+	unsigned int	mh_psize;	/* size of the block below, or 0 */
+	unsigned int	mh_size;	/* this block's, tag included	*/
+	struct	mhead	*mh_next;	/* size class list; free only	*/
+	struct	mhead	*mh_prev;
+	};
+#define	MH_USED		1		/* in mh_size: block in use	*/
+#define	MHDR		(2 * sizeof(unsigned int))	/* tag size	*/
+#define	MHMIN		sizeof(struct mhead)	/* smallest free block	*/
+#define	NMBIN		32		/* list b: sizes 2^b to 2^(b+1)	*/
+
+#define	mh_len(h)	((h)->mh_size & ~MH_USED)
+#define	mh_above(h)	((struct mhead *)((unsigned)(h) + mh_len(h)))
+#define	mh_below(h)	((struct mhead *)((unsigned)(h) - (h)->mh_psize))
+
+struct	memstat	{
+	unsigned int	ms_total;	/* heap bytes, tags included	*/
+	unsigned int	ms_free;	/* free bytes, tags included	*/
+	unsigned int	ms_nfree;	/* free blocks			*/
+	unsigned int	ms_largest;	/* largest getmem that fits	*/
+	unsigned int	ms_frag;	/* % of free bytes not in it	*/
+	};
+
+extern	struct	mhead	*mbins[];	/* free blocks by size class	*/
+extern	unsigned long	mbinmap;	/* bit b set: mbins[b] not empty */
+extern	struct	mhead	*mtail;		/* end tag at the top of memory	*/
 extern	char	*maxaddr;		/* max memory address		*/
 extern	WORD	_end;			/* address beyond loaded memory	*/
 extern	WORD	*end;			/* &_end + FILLSIZE		*/
 
+void	mh_init(char *lo, char *hi);
+void	mh_link(struct mhead *h, unsigned int size);
+void	mh_unlink(struct mhead *h);
+int	mh_bin(unsigned int size);
+struct	mhead	*mh_take(struct mhead *h, unsigned int need, int top);
+SYSCALL	memstat(struct memstat *msp);
+
 #endif
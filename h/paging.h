@@ -1,7 +1,21 @@
 /* paging.h */
 
+#ifndef _PAGING_H_
+#define _PAGING_H_
+
 typedef unsigned int	 bsd_t;
 
+#define PGHBUCKETS	32	/* fault latency histogram buckets	*/
+
+#define NBS		16	/* number of backing stores		*/
+#define VHMINSHIFT	4	/* smallest vheap size class, 16 bytes	*/
+#define NVHCLASS	8	/*  up to 2048; bigger objects get pages */
+#define VHMAXOBJ	(4096 >> VHMINSHIFT) /* objects in a run	*/
+#define NBSPAGES	256	/* max pages in one backing store	*/
+#define NBSMAPS		128	/* mappings of stores, in all		*/
+#define NPMAPS		16	/* mappings held by one process		*/
+#define BM_NONE		(-1)	/* end of a bsmaps list			*/
+
 /* Structure for a page directory entry */
 
 typedef struct {
@@ -13,7 +27,7 @@ typedef struct {
   unsigned int pd_pcd	: 1;		/* cache disable for this pt?	*/
   unsigned int pd_acc	: 1;		/* page table was accessed?	*/
   unsigned int pd_mbz	: 1;		/* must be zero			*/
-  unsigned int pd_fmb	: 1;		/* four MB pages?		*/
+  unsigned int pd_fmb	: 1;		/* four MB pages? (CR4.PSE)	*/
   unsigned int pd_global: 1;		/* global (ignored)		*/
   unsigned int pd_avail : 3;		/* for programmer's use		*/
   unsigned int pd_base	: 20;		/* location of page table?	*/
@@ -31,7 +45,7 @@ typedef struct {
   unsigned int pt_acc	: 1;		/* page was accessed?		*/
   unsigned int pt_dirty : 1;		/* page was written?		*/
   unsigned int pt_mbz	: 1;		/* must be zero			*/
-  unsigned int pt_global: 1;		/* should be zero in 586	*/
+  unsigned int pt_global: 1;		/* kept across CR3 loads (PGE)	*/
   unsigned int pt_avail : 3;		/* for programmer's use		*/
   unsigned int pt_base	: 20;		/* location of page?		*/
 } pt_t;
@@ -42,14 +56,69 @@ typedef struct{
   unsigned int pd_offset : 10;		/* page directory offset	*/
 } virt_addr_t;
 
+struct	rastate	{			/* read-ahead, per mapping	*/
+  int ra_next;				/* vpno a sequential fault hits	*/
+  int ra_win;				/* pages to read ahead		*/
+  int ra_advice;			/* XM_NORMAL, XM_SEQUENTIAL, ...*/
+};
+
 typedef struct{
   int bs_status;			/* MAPPED or UNMAPPED		*/
   int bs_pid;				/* process id using this slot   */
   int bs_vpno;				/* starting virtual page number */
   int bs_npages;			/* number of pages in the store */
+  int bs_base;				/* its extent starts at this page */
   int bs_sem;				/* semaphore mechanism ?	*/
+  int bs_private;			/* private heap of bs_pid?	*/
+  int bs_nmaps;				/* mappings of the store	*/
+  int bs_maps;				/* first of them, in bsmaps	*/
+  unsigned long bs_fresh[NBSPAGES/32];	/* pages never written		*/
 } bs_map_t;
 
+struct	bsdstat	{			/* the backing store device	*/
+  int bd_reqs;				/* requests queued		*/
+  int bd_pages;				/* pages they moved		*/
+  int bd_queued;			/* in the queue now		*/
+  int bd_maxq;				/* longest the queue has been	*/
+  int bd_waits;				/* times a process blocked	*/
+  unsigned long bd_waitms;		/* ms spent blocked		*/
+};
+
+struct	bsio	{			/* one page of a batched transfer */
+  char *bi_addr;			/* the page in memory		*/
+  int bi_store;				/* and on the backing store	*/
+  int bi_page;
+};
+
+struct	vhpage	{			/* a page of a virtual heap	*/
+  short vp_class;			/* size class, or VH_FREE, ...	*/
+  short vp_nfree;			/* free objects in the run	*/
+  int vp_npages;			/* pages in a span (first page)	*/
+  int vp_next;				/* next run of the class, or	*/
+					/*  next free span		*/
+  unsigned long vp_map[VHMAXOBJ/32];	/* free objects of the run	*/
+};
+
+struct	vheap	{			/* kept out of the heap itself	*/
+  unsigned vh_size;			/* bytes of this structure	*/
+  int vh_npages;
+  int vh_free;				/* free spans, by address	*/
+  int vh_runs[NVHCLASS];		/* runs with free objects	*/
+  struct vhpage vh_pg[1];		/* vh_npages of them		*/
+};
+
+typedef struct{			/* a process maps a store	*/
+  int bm_pid;				/* process, BADPID if free	*/
+  int bm_vpno;				/* first virtual page		*/
+  int bm_npages;			/*  from page 0 of the store	*/
+  int bm_store;
+  int bm_cow;				/* mapped copy-on-write?	*/
+  int bm_snext;				/* next mapping of the store	*/
+  struct rastate bm_ra;			/* read-ahead state		*/
+  unsigned long bm_pin[NBSPAGES/32];	/* pages it has xmlocked	*/
+  unsigned long bm_pnew[NBSPAGES/32];	/* pinned by the xmlock running */
+} bm_map_t;
+
 typedef struct{
   int fr_status;			/* MAPPED or UNMAPPED		*/
   int fr_pid;				/* process id using this frame  */
@@ -57,13 +126,222 @@ typedef struct{
   int fr_refcnt;			/* reference count		*/
   int fr_type;				/* FR_DIR, FR_TBL, FR_PAGE	*/
   int fr_dirty;
+  int fr_next;				/* next frame on the free list	*/
+  int fr_qnext;				/* resident ring, used by the	*/
+  int fr_qprev;				/*  replacement policy		*/
+  int fr_age;				/* aging counter (AGING)	*/
+  unsigned long fr_ltime;		/* last referenced (WSCLOCK)	*/
+  int fr_store;				/* store page held, FRM_NONE	*/
+  int fr_pageth;			/*  for a private copy		*/
+  int fr_hnext;				/* next on the store page hash	*/
+  int fr_npte;				/* FR_TBL: present entries+holds*/
+  int fr_io;				/* in transit: wait slot + 1	*/
+  int fr_pin;				/* xmlocks on the page		*/
+  int fr_rnext;				/* resident list of fr_pid	*/
+  int fr_rprev;
 }fr_map_t;
 
+struct	pgpolicy {			/* page replacement policy	*/
+  int	pp_id;				/* SC, FIFO, AGING, WSCLOCK	*/
+  char	*pp_name;
+  int	(*pp_victim)(void);		/* choose a frame to evict	*/
+  void	(*pp_map)(int);			/* frame now holds a page	*/
+  void	(*pp_sample)(void);		/* periodic reference sampling	*/
+  void	(*pp_free)(int);		/* frame leaves the ring	*/
+};
+
+struct	frmstat	{			/* frame usage, from frm_stats	*/
+  int fs_free;				/* frames on the free list	*/
+  int fs_used;				/* frames in use		*/
+  int fs_page;				/* FR_PAGE frames		*/
+  int fs_tbl;				/* FR_TBL frames		*/
+  int fs_dir;				/* FR_DIR frames		*/
+  int fs_direct;			/* evictions inside get_frm	*/
+  int fs_bgwake;			/* reclaim daemon passes	*/
+  int fs_bgpages;			/* pages the daemon evicted	*/
+  int fs_pinned;			/* frames pinned by xmlock	*/
+};
+
+struct	zsstat	{			/* compressed cache, zs_stats	*/
+  unsigned zs_size;			/* pool bytes			*/
+  unsigned zs_used;			/* pool bytes holding pages	*/
+  int zs_npages;			/* pages compressed in the pool	*/
+  int zs_stores;			/* pages saved			*/
+  int zs_same;				/*  of them same-filled		*/
+  int zs_rejects;			/*  sent straight to the store	*/
+  int zs_wback;				/* written back to make room	*/
+  int zs_loads;				/* pages loaded			*/
+  int zs_hits;				/*  served from the cache	*/
+};
+
+struct	pgstats	{			/* paging counters, pgstats	*/
+  int ps_faults;			/* page faults			*/
+  int ps_major;				/*  read from the backing store	*/
+  int ps_minor;				/*  served without device I/O	*/
+  int ps_evict;				/* pages evicted		*/
+  int ps_wback;				/* dirty pages written back	*/
+  unsigned ps_rdbytes;			/* bytes read by read_bs	*/
+  unsigned ps_wrbytes;			/* bytes written by write_bs	*/
+  int ps_ptalloc;			/* page tables allocated	*/
+  int ps_pinned;			/* pages xmlocked now		*/
+  int ps_hist[PGHBUCKETS];		/* faults by log2(cycles)	*/
+};
+
 extern bs_map_t bsm_tab[];
+extern bm_map_t bsmaps[];
 extern fr_map_t frm_tab[];
+extern int frm_nfree;			/* length of the free list	*/
+extern int frm_ntype[];			/* in-use frames by fr_type	*/
+extern int frm_ndirect;			/* evictions inside get_frm	*/
+extern int frm_hand;			/* replacement hand into ring	*/
+extern int zero_frm;			/* shared all-zero page		*/
+extern int frm_npin;			/* frames pinned, NFRPIN at most*/
+extern int frm_rlist[];			/* FR_PAGE frames charged to pid */
+extern struct pgpolicy *pgpolicy;	/* current replacement policy	*/
+
+/* frame table management */
+
+SYSCALL init_frm(void);
+SYSCALL get_frm(int *);
+SYSCALL free_frm(int);
+void	set_frm(int, int, int, int);
+SYSCALL frm_stats(struct frmstat *);
+SYSCALL evict_frm(int);
+void	frm_unmap(int, int);
+SYSCALL clean_frm(int);
+int	frm_dirty(int);
+void	frm_clrdirty(int);
+int	frm_testacc(int, int);
+void	frm_setstore(int, int, int);
+int	frm_find(int, int);
+pt_t	*frm_pte(int, int *, int *, int *);
+int	frm_evictable(int);
+SYSCALL frm_pin(int);
+void	frm_unpin(int);
+void	frm_charge(int, int);
+SYSCALL frm_teardown(int);
+
+/* backing store map */
+
+SYSCALL init_bsm(void);
+SYSCALL get_bsm(int *);
+SYSCALL free_bsm(int);
+SYSCALL bsm_find(int, int);
+SYSCALL bs_extalloc(int, int);
+SYSCALL setswap(int);
+SYSCALL sw_out(int);
+SYSCALL sw_in(int, int);
+SYSCALL sw_free(int, int, int);
+int	sw_full(void);
+void	bs_compact(void);
+SYSCALL bsm_lookup(int, long, int *, int *);
+SYSCALL bsm_map(int, int, int, int);
+SYSCALL bsm_unmap(int, int, int);
+SYSCALL bsm_unmapall(int);
+void	bs_setfresh(int, int);
+
+/* compressed page cache */
+
+SYSCALL zs_load(char *, int, int);
+SYSCALL zs_store(char *, int, int);
+SYSCALL zs_loadv(struct bsio *, int);
+SYSCALL zs_storev(struct bsio *, int);
+void	zs_inval(int);
+SYSCALL set_zpool(unsigned);
+SYSCALL zs_stats(struct zsstat *);
+
+/* working sets and frame quotas */
+
+void	ws_window(void);
+SYSCALL frm_trim(int);
+SYSCALL getwss(int);
+SYSCALL setfrmquota(int, int, int);
+
+/* paging statistics */
+
+extern struct pgstats pg_gstats, pg_pstats[];
+void	pgs_clear(int);
+void	pgs_fault(int, int, unsigned long long);
+SYSCALL pgstats(int, struct pgstats *);
+void	pgdump(void);
+
+/* count n against field f, in total and (unless pid is bad) for pid */
+#define pgs_inc(pid, f, n)	(pg_gstats.f += (n), isbadpid(pid) ? (void) 0 : \
+				 (void) (pg_pstats[pid].f += (n)))
+
+/* read-ahead */
+
+void	readahead(int, int, int, int);
+void	ra_reset(int);
+
+/* control registers */
+
+unsigned long read_cr0(void);
+unsigned long read_cr2(void);
+unsigned long read_cr3(void);
+unsigned long read_cr4(void);
+void	write_cr0(unsigned long);
+void	write_cr3(unsigned long);
+void	write_cr4(unsigned long);
+void	enable_paging(void);
+unsigned long long rdtsc(void);
+unsigned long cpu_features(void);
+void	tlb_flush_page(unsigned long);
+void	tlb_flush_range(int, int);
+
+/* only the current process has user mappings in the TLB */
+#define tlb_shoot(pid, vpno, n)	((pid) == currpid ? \
+				 tlb_flush_range(vpno, n) : (void) 0)
+
+/* page tables */
+
+extern int gpt_frm[];			/* shared kernel page tables	*/
+extern int pse_on;			/*  or 4 MB pages in their place*/
+extern int pge_on;			/* CPU keeps global TLB entries */
+SYSCALL init_gpt(void);
+SYSCALL pd_alloc(int);
+SYSCALL pd_free(int);
+pt_t	*pte_lookup(int, int);
+pt_t	*pte_alloc(int, int);
+void	pt_hold(int, int);
+void	pt_release(int, int);
+
+/* replacement policy */
+
+SYSCALL srpolicy(int);
+SYSCALL grpolicy(void);
+void	pol_insert(int);
+void	pol_remove(int);
+void	pgtick(void);
+
+/* page cleaner */
+
+extern int cleanpid;
+extern int dirty_lowat, dirty_hiwat;
+PROCESS	pgcleaner(void);
+SYSCALL set_dirty_watermarks(int, int);
+
+/* free frame reserve */
+
+extern int rclpid, rclsem;
+extern int frm_lowat, frm_hiwat;
+extern int rcl_nwake, rcl_npages;
+PROCESS	pgreclaim(void);
+SYSCALL set_frm_watermarks(int, int);
 /* Prototypes for required API calls */
 SYSCALL xmmap(int, bsd_t, int);
-SYSCALL xunmap(int);
+SYSCALL xmunmap(int);
+SYSCALL xmmap_cow(int, bsd_t, int);
+SYSCALL pfint(void);
+SYSCALL pgin(int, int, int, int);
+SYSCALL pgin_v(int, int, int, int, struct bsio *, int *);
+SYSCALL pgout(int, int, int);
+SYSCALL cow_break(int, int);
+SYSCALL zfill(int, int, int, int);
+SYSCALL xmadvise(int, int, int);
+SYSCALL xmlock(int, int);
+SYSCALL xmunlock(int, int);
+SYSCALL xm_unpin(int, int);
 
 /* given calls for dealing with backing store */
 
@@ -71,10 +349,38 @@ int get_bs(bsd_t, unsigned int);
 SYSCALL release_bs(bsd_t);
 SYSCALL read_bs(char *, bsd_t, int);
 SYSCALL write_bs(char *, bsd_t, int);
+SYSCALL read_bs_v(struct bsio *, int);
+SYSCALL write_bs_v(struct bsio *, int);
+
+/* virtual heap */
+struct	vheap *vh_create(int);
+int	vh_getpages(struct vheap *, int);
+void	vh_putpages(struct vheap *, int, int);
+
+/* backing store device */
+SYSCALL init_bsdev(void);
+SYSCALL setbsdev(int, int);
+void	bsd_submit(int);
+void	bsd_wait(void);
+void	bsd_tick(void);
+void	bsd_cancel(int);
+unsigned long bsd_owed(int);
+SYSCALL frm_transit(int, unsigned long);
+void	frm_wait(int);
+SYSCALL bsdstats(struct bsdstat *);
 
 #define NBPG		4096	/* number of bytes per page	*/
 #define FRAME0		1024	/* zero-th frame		*/
 #define NFRAMES 	1024	/* number of frames		*/
+#define NPTE		1024	/* entries per page table/directory */
+#define NGPT		4	/* page tables mapping the first 16M */
+
+#define TLBRANGEMAX	32	/* invlpg at most this many pages	*/
+
+#define CPU_PSE		0x08	/* cpu_features: 4 MB pages		*/
+#define CR4_PSE		0x10	/* CR4: page size extensions		*/
+#define CPU_PGE		0x2000	/* cpu_features: global pages		*/
+#define CR4_PGE		0x80	/* CR4: page global enable		*/
 
 #define BSM_UNMAPPED	0
 #define BSM_MAPPED	1
@@ -85,9 +391,92 @@ SYSCALL write_bs(char *, bsd_t, int);
 #define FR_PAGE		0
 #define FR_TBL		1
 #define FR_DIR		2
+#define NFRTYPES	3
+
+#define FRM_NONE	(-1)		/* end of the frame free list	*/
+#define NFRHASH		256		/* store page hash buckets	*/
+#define NFRPIN		(NFRAMES / 4)	/* frames xmlock may pin at once */
+
+#define PF_PROT		0x1		/* pferrcode: page was present	*/
+#define PF_WRITE	0x2		/* pferrcode: fault on a write	*/
+
+#define frm_addr(i)	((char *)((FRAME0 + (i)) * NBPG))
+#define frm_id(a)	((int)((unsigned long)(a) / NBPG) - FRAME0)
 
 #define SC 3
 #define FIFO 4
+#define AGING 5
+#define WSCLOCK 6
+
+#define PGSAMPLE	10	/* ticks between reference samples	*/
+#define WSTAU		200	/* WSCLOCK working-set window (ms)	*/
+
+#define CLEANPRIO	10	/* page cleaner runs below user procs	*/
+#define CLEANPERIOD	1	/* cleaner scan period (1/10 s)		*/
+#define DIRTYLO		16	/* cleaner stops at this many dirty	*/
+#define DIRTYHI		64	/* cleaner starts above this many dirty	*/
+
+#define RCLPRIO		20	/* reclaim daemon shares the user prio	*/
+#define FRMLOWAT	16	/* wake the reclaim daemon below this	*/
+#define FRMHIWAT	48	/* daemon refills the reserve to this	*/
+
+#define PT_WSREF	0x1	/* pt_avail: referenced, for ws_window	*/
+#define PT_POLREF	0x2	/* pt_avail: referenced, for the policy	*/
+#define PT_SWAP		0x4	/* pt_avail: not present, pt_base a slot */
+
+#define NSWAP		512	/* swap slots, at the top of the region	*/
+#define SWCLUSTER	8	/* slots written and read together	*/
+#define pte_slot(pte)	((int)(pte)->pt_base)
+
+#define WSWINDOW	100	/* ticks in a working-set window	*/
+#define PFFHI		8	/* faults a window that grow the quota	*/
+#define PFFLO		2	/* faults a window that shrink it	*/
+#define PFFSTEP		8	/* frames given up per quiet window	*/
+
+#define RAMIN		2	/* first read-ahead window (pages)	*/
+#define RAMAX		32	/* largest read-ahead window (pages)	*/
+
+#define XM_NORMAL	0	/* xmadvise: adaptive read-ahead	*/
+#define XM_SEQUENTIAL	1	/*  read ahead RAMAX pages		*/
+#define XM_RANDOM	2	/*  no read-ahead			*/
+#define XM_WILLNEED	3	/*  page the range in now		*/
+#define XM_DONTNEED	4	/*  page the range out now		*/
 
 #define BACKING_STORE_BASE	0x00800000
-#define BACKING_STORE_UNIT_SIZE 0x00100000
+#define BACKING_STORE_SIZE	0x00800000
+#define BS_NPAGES	(BACKING_STORE_SIZE / NBPG - NSWAP) /* for extents */
+#define sw_addr(s)	((char *)(BACKING_STORE_BASE + \
+			 (BS_NPAGES + (s)) * NBPG))
+
+#define bs_addr(s, p)	((char *)(BACKING_STORE_BASE + \
+			 (bsm_tab[s].bs_base + (p)) * NBPG))
+
+/* never-written heap pages read as the zero page, and need no read_bs */
+#define bs_isfresh(s, p)	(bsm_tab[s].bs_fresh[(p) >> 5] & (1UL << ((p) & 31)))
+#define bs_clrfresh(s, p)	(bsm_tab[s].bs_fresh[(p) >> 5] &= ~(1UL << ((p) & 31)))
+
+/* pages a mapping holds pinned, by page of the mapping */
+#define bm_ispinned(m, p)	(bsmaps[m].bm_pin[(p) >> 5] & (1UL << ((p) & 31)))
+#define bm_setpin(m, p)		(bsmaps[m].bm_pin[(p) >> 5] |= 1UL << ((p) & 31))
+#define bm_clrpin(m, p)		(bsmaps[m].bm_pin[(p) >> 5] &= ~(1UL << ((p) & 31)))
+#define bm_isnew(m, p)		(bsmaps[m].bm_pnew[(p) >> 5] & (1UL << ((p) & 31)))
+#define bm_setnew(m, p)		(bsmaps[m].bm_pnew[(p) >> 5] |= 1UL << ((p) & 31))
+#define bm_clrnew(m, p)		(bsmaps[m].bm_pnew[(p) >> 5] &= ~(1UL << ((p) & 31)))
+
+#define ZPOOLSIZE	(128*1024) /* default compressed pool bytes	*/
+#define ZSMAXLEN	(NBPG*3/4) /* compress no worse than this	*/
+#define ZHBITS		10	/* compressor hash table bits		*/
+#define BSIOMAX		32	/* pages in one batched transfer	*/
+#define NBSREQ		64	/* requests the device queue holds	*/
+#define NFRIO		16	/* frames in transit at once		*/
+
+#define VHPNO		4096	/* virtual heap starts past the 16M	*/
+#define VCMAXARGS	8	/* arguments vcreate passes on		*/
+
+#define VH_FREE		(-1)	/* vp_class: page in a free span	*/
+#define VH_LARGE	(-2)	/*  first page of a large object	*/
+#define VH_CONT		(-3)	/*  later page of a span or object	*/
+#define VH_NONE		(-1)	/* end of a vp_next list		*/
+#define vh_objsize(c)	(1 << ((c) + VHMINSHIFT))
+
+#endif
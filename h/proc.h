@@ -76,7 +76,14 @@ struct	pentry	{
         int     store;                  /* backing store for vheap      */
         int     vhpno;                  /* starting pageno for vheap    */
         int     vhpnpages;              /* vheap size                   */
-        struct mblock *vmemlist;        /* vheap list              	*/
+        struct vheap *vheap;            /* vheap bookkeeping, in kernel */
+        int     prss;                   /* resident frames charged      */
+        int     pflts;                  /* faults this window           */
+        int     pfltrate;               /* faults in the last window    */
+        int     pwss;                   /* working-set estimate (pages) */
+        int     pfrmmin;                /* frames kept from eviction    */
+        int     pfrmmax;                /* most frames it may hold      */
+        int     ptarget;                /* PFF's current allotment      */
 };
 
 
@@ -0,0 +1,261 @@
+/* bsdev.c - setbsdev, bsd_submit, bsd_wait, bsd_tick, frm_wait, bsdstats */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <sem.h>
+#include <paging.h>
+
+/*
+ * The backing store is memory, so a transfer is over as soon as it is
+ * asked for; this layer only makes it cost time.  Requests are served
+ * one at a time, in order: each ends bsd_lat ms after the device comes
+ * free, plus its size at bsd_bw bytes a ms.  The process that asked
+ * owes the time until its last request ends, and pays it where the
+ * paging state is consistent (the end of a fault, a turn of a daemon's
+ * loop) by waiting on a semaphore of its own, which the clock signals
+ * when the time comes.  Other processes run meanwhile.  The waiters
+ * are kept in order of when they are done, so the clock looks only at
+ * those it wakes.
+ *
+ * A page read in on demand is also in transit until its request ends:
+ * its frame takes one of NFRIO wait slots (fr_io), cannot be evicted,
+ * and any process faulting on it, the first one included, waits on
+ * the slot's semaphore rather than reading it again.
+ */
+
+struct	bsreq	{			/* a request on the device	*/
+	int	br_pid;			/* who asked			*/
+	int	br_npages;
+	unsigned long br_due;		/* ctr1000 when it is done	*/
+};
+
+struct	frio	{			/* a frame being read in	*/
+	int	fi_frm;			/* FRM_NONE if the slot is free	*/
+	int	fi_sem;			/* its waiters			*/
+	int	fi_nwait;
+	unsigned long fi_due;		/* when the read ends		*/
+};
+
+LOCAL	struct	bsreq	bsq[NBSREQ];	/* the queue, oldest first	*/
+LOCAL	int	bsq_head, bsq_n;
+LOCAL	struct	frio	fio[NFRIO];
+LOCAL	unsigned long bsd_due[NPROC];	/* end of each process's I/O	*/
+LOCAL	int	bsd_sem[NPROC];		/* each process waits on its own */
+LOCAL	int	bsd_wnext[NPROC];	/* waiters, soonest done first	*/
+LOCAL	int	bsd_whead = BADPID;
+LOCAL	unsigned long bsd_free;		/* when the device goes idle	*/
+LOCAL	int	bsd_lat, bsd_bw;	/* ms a request, bytes a ms	*/
+LOCAL	struct	bsdstat	bsd;
+
+extern unsigned long ctr1000;
+
+/*-------------------------------------------------------------------------
+ * init_bsdev - set up the device, idle and infinitely fast
+ *-------------------------------------------------------------------------
+ */
+SYSCALL init_bsdev()
+{
+	int	w, pid;
+
+	for (w=0 ; w<NFRIO ; w++) {
+		fio[w].fi_frm = FRM_NONE;
+		if ((fio[w].fi_sem = screate(0)) == SYSERR)
+			return SYSERR;
+	}
+	for (pid=0 ; pid<NPROC ; pid++)
+		if ((bsd_sem[pid] = screate(0)) == SYSERR)
+			return SYSERR;
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * setbsdev - make each request take lat ms plus its size at bw bytes
+ *	a ms; 0 and 0 turn the delays off
+ *-------------------------------------------------------------------------
+ */
+SYSCALL setbsdev(int lat, int bw)
+{
+	STATWORD ps;
+
+	if (lat < 0 || bw < 0)
+		return SYSERR;
+	disable(ps);
+	bsd_lat = lat;
+	bsd_bw = bw;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * bsd_submit - queue a request of npages for currpid
+ *-------------------------------------------------------------------------
+ */
+void bsd_submit(int npages)
+{
+	STATWORD ps;
+	struct	bsreq	*brp;
+	unsigned long due;
+
+	if ((bsd_lat == 0 && bsd_bw == 0) || isbadpid(currpid))
+		return;
+	disable(ps);
+	due = max(ctr1000, bsd_free) + bsd_lat;
+	if (bsd_bw > 0)
+		due += (npages * NBPG + bsd_bw - 1) / bsd_bw;
+	bsd_free = bsd_due[currpid] = due;
+	if (bsq_n == NBSREQ) {			/* full: the last grows	*/
+		brp = &bsq[(bsq_head + bsq_n - 1) % NBSREQ];
+		brp->br_npages += npages;
+	} else {
+		brp = &bsq[(bsq_head + bsq_n++) % NBSREQ];
+		brp->br_npages = npages;
+	}
+	brp->br_pid = currpid;
+	brp->br_due = due;
+	bsd.bd_reqs++;
+	bsd.bd_pages += npages;
+	bsd.bd_maxq = max(bsd.bd_maxq, bsq_n);
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * bsd_wait - block currpid until the device has done its requests
+ *-------------------------------------------------------------------------
+ */
+void bsd_wait()
+{
+	STATWORD ps;
+	unsigned long t0;
+	int	*link;
+
+	disable(ps);
+	if (isbadpid(currpid) || bsd_due[currpid] <= ctr1000) {
+		restore(ps);
+		return;
+	}
+	for (link = &bsd_whead ; *link != BADPID &&
+	     bsd_due[*link] <= bsd_due[currpid] ; link = &bsd_wnext[*link])
+		;
+	bsd_wnext[currpid] = *link;
+	*link = currpid;
+	t0 = ctr1000;
+	bsd.bd_waits++;
+	wait(bsd_sem[currpid]);
+	bsd.bd_waitms += ctr1000 - t0;
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * bsd_tick - retire finished requests and wake whoever has paid
+ *	(called from pgtick, in the clock interrupt)
+ *-------------------------------------------------------------------------
+ */
+void bsd_tick()
+{
+	int	w;
+
+	while (bsq_n > 0 && bsq[bsq_head].br_due <= ctr1000) {
+		bsq_head = (bsq_head + 1) % NBSREQ;
+		bsq_n--;
+	}
+	for (w=0 ; w<NFRIO ; w++)
+		if (fio[w].fi_frm != FRM_NONE && fio[w].fi_due <= ctr1000) {
+			if (frm_tab[fio[w].fi_frm].fr_io == w+1)
+				frm_tab[fio[w].fi_frm].fr_io = 0;
+			fio[w].fi_frm = FRM_NONE;
+			if (fio[w].fi_nwait > 0)
+				signalnr(fio[w].fi_sem, fio[w].fi_nwait);
+		}
+	while (bsd_whead != BADPID && bsd_due[bsd_whead] <= ctr1000) {
+		signalnr(bsd_sem[bsd_whead], 1);
+		bsd_whead = bsd_wnext[bsd_whead];
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * bsd_owed - when pid's last request ends, or 0 if it has
+ *-------------------------------------------------------------------------
+ */
+unsigned long bsd_owed(int pid)
+{
+	return bsd_due[pid] > ctr1000 ? bsd_due[pid] : 0;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_transit - frame i is being read in until due; SYSERR (and the
+ *	page is usable at once) if every wait slot is taken
+ *-------------------------------------------------------------------------
+ */
+SYSCALL frm_transit(int i, unsigned long due)
+{
+	STATWORD ps;
+	int	w;
+
+	disable(ps);
+	for (w=0 ; w<NFRIO && fio[w].fi_frm != FRM_NONE ; w++)
+		;
+	if (w == NFRIO || due <= ctr1000) {
+		restore(ps);
+		return SYSERR;
+	}
+	fio[w].fi_frm = i;
+	fio[w].fi_nwait = 0;
+	fio[w].fi_due = due;
+	frm_tab[i].fr_io = w + 1;
+	semaph[fio[w].fi_sem].semcnt = 0;	/* waiters killed last time */
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_wait - block until frame i is no longer in transit
+ *-------------------------------------------------------------------------
+ */
+void frm_wait(int i)
+{
+	STATWORD ps;
+	int	w;
+
+	disable(ps);
+	if ((w = frm_tab[i].fr_io - 1) >= 0) {
+		fio[w].fi_nwait++;
+		bsd.bd_waits++;
+		wait(fio[w].fi_sem);
+	}
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * bsd_cancel - forget what a dying process owes; kill puts the count of
+ *	a semaphore it waits on right
+ *-------------------------------------------------------------------------
+ */
+void bsd_cancel(int pid)
+{
+	int	*link;
+
+	bsd_due[pid] = 0;
+	for (link = &bsd_whead ; *link != BADPID ; link = &bsd_wnext[*link])
+		if (*link == pid) {
+			*link = bsd_wnext[pid];
+			break;
+		}
+}
+
+/*-------------------------------------------------------------------------
+ * bsdstats - report the device counters and its queue length now
+ *-------------------------------------------------------------------------
+ */
+SYSCALL bsdstats(struct bsdstat *bdp)
+{
+	STATWORD ps;
+
+	if (bdp == NULL)
+		return SYSERR;
+	disable(ps);
+	bsd.bd_queued = bsq_n;
+	*bdp = bsd;
+	restore(ps);
+	return OK;
+}
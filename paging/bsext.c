@@ -0,0 +1,100 @@
+/* bsext.c - bs_extalloc, bs_compact */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+/*
+ * The backing region is carved into page-granular extents, one per
+ * mapped store, described only by bs_base and bs_npages; a store that
+ * is freed simply leaves a hole.  Allocation is first fit.  When no
+ * hole is large enough but the holes together are, the extents are
+ * slid down to the bottom of the region to merge them.  Frames and
+ * compressed pages are named by (store, page), never by address, so
+ * moving an extent needs nothing but the copy.
+ */
+
+LOCAL	int	bs_fit();
+
+/*-------------------------------------------------------------------------
+ * bs_extalloc - give store an extent of npages, compacting if need be
+ *-------------------------------------------------------------------------
+ */
+SYSCALL bs_extalloc(int store, int npages)
+{
+	STATWORD ps;
+	int	i, used, base;
+
+	if (store < 0 || store >= NBS || npages <= 0 || npages > NBSPAGES)
+		return SYSERR;
+	disable(ps);
+	bsm_tab[store].bs_npages = 0;		/* not in its own way	*/
+	if ((base = bs_fit(npages)) == SYSERR) {
+		for (i=0,used=0 ; i<NBS ; i++)
+			used += bsm_tab[i].bs_npages;
+		if (used + npages > BS_NPAGES) {
+			restore(ps);
+			return SYSERR;
+		}
+		bs_compact();
+		base = bs_fit(npages);
+	}
+	bsm_tab[store].bs_base = base;
+	bsm_tab[store].bs_npages = npages;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * bs_compact - slide every extent down, lowest first, so that all the
+ *	free space is one hole at the top of the region
+ *-------------------------------------------------------------------------
+ */
+void bs_compact()
+{
+	STATWORD ps;
+	bs_map_t *bsptr;
+	int	i, s, next, p;
+
+	disable(ps);
+	for (next = 0 ; ; next += bsptr->bs_npages) {
+		for (i=0,s=SYSERR ; i<NBS ; i++)	/* lowest extent left */
+			if (bsm_tab[i].bs_npages > 0 &&
+			    bsm_tab[i].bs_base >= next &&
+			    (s == SYSERR || bsm_tab[i].bs_base < bsm_tab[s].bs_base))
+				s = i;
+		if (s == SYSERR)
+			break;
+		bsptr = &bsm_tab[s];
+		if (bsptr->bs_base == next)
+			continue;
+		for (p=0 ; p<bsptr->bs_npages ; p++)	/* moving down	*/
+			bcopy(bs_addr(s, p),
+			      (char *)(BACKING_STORE_BASE + (next + p) * NBPG),
+			      NBPG);
+		bsptr->bs_base = next;
+	}
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * bs_fit - first page of the lowest hole of npages, or SYSERR
+ *-------------------------------------------------------------------------
+ */
+LOCAL int bs_fit(int npages)
+{
+	bs_map_t *bsptr;
+	int	i, base;
+
+	base = 0;
+	for (i=0 ; i<NBS ; i++) {
+		bsptr = &bsm_tab[i];
+		if (bsptr->bs_npages > 0 && bsptr->bs_base < base + npages &&
+		    base < bsptr->bs_base + bsptr->bs_npages) {
+			base = bsptr->bs_base + bsptr->bs_npages;
+			i = -1;				/* start over	*/
+		}
+	}
+	return base + npages <= BS_NPAGES ? base : SYSERR;
+}
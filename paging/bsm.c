@@ -5,29 +5,117 @@
 #include <paging.h>
 #include <proc.h>
 
+LOCAL	void	bsm_wback();
+
+/*
+ * A mapping of a store into a process lives in bsmaps and is on two
+ * lists: the store's (bs_maps, through bm_snext), walked to find every
+ * page table entry of a shared frame, and the process's pm_map, kept
+ * sorted on bm_vpno so a fault finds its mapping by binary search.
+ */
+
+bs_map_t bsm_tab[NBS];			/* one entry per backing store	*/
+bm_map_t bsmaps[NBSMAPS];		/* mappings of stores		*/
+int	bm_free;			/* free list of bsmaps		*/
+int	pm_map[NPROC][NPMAPS];		/* each process's mappings,	*/
+int	pm_n[NPROC];			/*  sorted on bm_vpno		*/
+
 /*-------------------------------------------------------------------------
  * init_bsm- initialize bsm_tab
  *-------------------------------------------------------------------------
  */
 SYSCALL init_bsm()
 {
+	int	i;
+
+	for (i=0 ; i<NBS ; i++)
+		free_bsm(i);
+	for (i=0 ; i<NBSMAPS ; i++) {
+		bsmaps[i].bm_pid = BADPID;
+		bsmaps[i].bm_snext = (i == NBSMAPS-1) ? BM_NONE : i+1;
+	}
+	bm_free = 0;
+	for (i=0 ; i<NPROC ; i++)
+		pm_n[i] = 0;
+	return OK;
 }
 
 /*-------------------------------------------------------------------------
- * get_bsm - get a free entry from bsm_tab 
+ * get_bsm - get a free entry from bsm_tab
  *-------------------------------------------------------------------------
  */
 SYSCALL get_bsm(int* avail)
 {
+	STATWORD ps;
+	int	i;
+
+	disable(ps);
+	for (i=0 ; i<NBS ; i++)
+		if (bsm_tab[i].bs_status == BSM_UNMAPPED) {
+			*avail = i;
+			restore(ps);
+			return OK;
+		}
+	restore(ps);
+	return SYSERR;
 }
 
 
 /*-------------------------------------------------------------------------
- * free_bsm - free an entry from bsm_tab 
+ * free_bsm - free an entry from bsm_tab
  *-------------------------------------------------------------------------
  */
 SYSCALL free_bsm(int i)
 {
+	STATWORD ps;
+	bs_map_t *bsptr;
+
+	if (i < 0 || i >= NBS)
+		return SYSERR;
+	disable(ps);
+	bsptr = &bsm_tab[i];
+	bsptr->bs_status = BSM_UNMAPPED;
+	bsptr->bs_pid = BADPID;
+	bsptr->bs_vpno = 0;
+	bsptr->bs_npages = 0;
+	bsptr->bs_base = 0;
+	bsptr->bs_sem = 0;
+	bsptr->bs_private = FALSE;
+	bsptr->bs_nmaps = 0;
+	bsptr->bs_maps = BM_NONE;
+	bs_setfresh(i, 0);
+	zs_inval(i);
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * bsm_find - the mapping of pid that covers vpno, by binary search of
+ *	pid's mappings sorted on bm_vpno
+ *-------------------------------------------------------------------------
+ */
+SYSCALL bsm_find(int pid, int vpno)
+{
+	bm_map_t *bmptr;
+	int	lo, hi, mid;
+
+	if (pid < 0 || pid >= NPROC)
+		return SYSERR;
+	lo = 0;
+	hi = pm_n[pid];
+	while (lo < hi) {		/* first mapping starting past vpno */
+		mid = (lo + hi) / 2;
+		if (bsmaps[pm_map[pid][mid]].bm_vpno <= vpno)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return SYSERR;
+	bmptr = &bsmaps[pm_map[pid][lo-1]];
+	if (vpno >= bmptr->bm_vpno + bmptr->bm_npages)
+		return SYSERR;
+	return pm_map[pid][lo-1];
 }
 
 /*-------------------------------------------------------------------------
@@ -36,25 +124,191 @@ SYSCALL free_bsm(int i)
  */
 SYSCALL bsm_lookup(int pid, long vaddr, int* store, int* pageth)
 {
+	STATWORD ps;
+	int	vpno, m;
+
+	vpno = (unsigned long) vaddr / NBPG;
+	disable(ps);
+	if ((m = bsm_find(pid, vpno)) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	*store = bsmaps[m].bm_store;
+	*pageth = vpno - bsmaps[m].bm_vpno;
+	restore(ps);
+	return OK;
 }
 
 
 /*-------------------------------------------------------------------------
- * bsm_map - add an mapping into bsm_tab 
+ * bsm_map - add an mapping into bsm_tab
+ *	A process may map a store more than once, but its mappings may
+ *	not overlap.
  *-------------------------------------------------------------------------
  */
 SYSCALL bsm_map(int pid, int vpno, int source, int npages)
 {
+	STATWORD ps;
+	bs_map_t *bsptr;
+	bm_map_t *bmptr;
+	int	m, pos, i;
+
+	if (pid < 0 || pid >= NPROC || source < 0 || source >= NBS ||
+	    npages <= 0 || npages > NBSPAGES)
+		return SYSERR;
+	disable(ps);
+	bsptr = &bsm_tab[source];
+	if (bsptr->bs_status != BSM_MAPPED || npages > bsptr->bs_npages ||
+	    bm_free == BM_NONE || pm_n[pid] >= NPMAPS) {
+		restore(ps);
+		return SYSERR;
+	}
+
+	/* where it goes in pid's sorted list; it must fit between	*/
+	for (pos=0 ; pos<pm_n[pid] &&
+	     bsmaps[pm_map[pid][pos]].bm_vpno < vpno ; pos++)
+		;
+	bmptr = (pos > 0) ? &bsmaps[pm_map[pid][pos-1]] : NULL;
+	if ((bmptr != NULL && bmptr->bm_vpno + bmptr->bm_npages > vpno) ||
+	    (pos < pm_n[pid] &&
+	     bsmaps[pm_map[pid][pos]].bm_vpno < vpno + npages)) {
+		restore(ps);
+		return SYSERR;
+	}
+
+	m = bm_free;
+	bmptr = &bsmaps[m];
+	bm_free = bmptr->bm_snext;
+	bmptr->bm_pid = pid;
+	bmptr->bm_vpno = vpno;
+	bmptr->bm_npages = npages;
+	bmptr->bm_store = source;
+	bmptr->bm_cow = FALSE;
+	for (i=0 ; i<NBSPAGES/32 ; i++)
+		bmptr->bm_pin[i] = bmptr->bm_pnew[i] = 0;
+	bmptr->bm_snext = bsptr->bs_maps;
+	bsptr->bs_maps = m;
+	for (i = pm_n[pid] ; i > pos ; i--)
+		pm_map[pid][i] = pm_map[pid][i-1];
+	pm_map[pid][pos] = m;
+	pm_n[pid]++;
+	bsptr->bs_nmaps++;
+	ra_reset(m);
+	restore(ps);
+	return OK;
 }
 
 
 
 /*-------------------------------------------------------------------------
- * bsm_unmap - delete an mapping from bsm_tab
+ * bsm_unmap - delete the mapping of pid covering vpno
+ *	If flag is set, dirty pages nobody else maps are written back
+ *	first; otherwise they are simply discarded.
  *-------------------------------------------------------------------------
  */
 SYSCALL bsm_unmap(int pid, int vpno, int flag)
 {
+	STATWORD ps;
+	bs_map_t *bsptr;
+	bm_map_t *bmptr;
+	int	m, *link, i;
+
+	disable(ps);
+	if ((m = bsm_find(pid, vpno)) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	bmptr = &bsmaps[m];
+	bsptr = &bsm_tab[bmptr->bm_store];
+	if (flag)
+		bsm_wback(bmptr);
+	for (vpno = bmptr->bm_vpno ;
+	     vpno < bmptr->bm_vpno + bmptr->bm_npages ; vpno++)
+		pgout(pid, vpno, flag);
+	tlb_shoot(pid, bmptr->bm_vpno, bmptr->bm_npages);
+
+	for (link = &bsptr->bs_maps ; *link != m ;
+	     link = &bsmaps[*link].bm_snext)
+		;
+	*link = bmptr->bm_snext;
+	for (i=0 ; pm_map[pid][i] != m ; i++)
+		;
+	for (pm_n[pid]-- ; i < pm_n[pid] ; i++)
+		pm_map[pid][i] = pm_map[pid][i+1];
+	bmptr->bm_pid = BADPID;
+	bmptr->bm_snext = bm_free;
+	bm_free = m;
+
+	bsptr->bs_nmaps--;
+	if (bsptr->bs_private && bsptr->bs_nmaps == 0)
+		free_bsm(bsptr - bsm_tab);
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * bsm_unmapall - drop every mapping held by pid (process exit)
+ *-------------------------------------------------------------------------
+ */
+SYSCALL bsm_unmapall(int pid)
+{
+	STATWORD ps;
+	bm_map_t *bmptr;
+
+	disable(ps);
+	while (pm_n[pid] > 0) {
+		bmptr = &bsmaps[pm_map[pid][pm_n[pid]-1]];
+		bsm_unmap(pid, bmptr->bm_vpno,
+			  !bsm_tab[bmptr->bm_store].bs_private);
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * bsm_wback - write back together the dirty pages of a mapping that
+ *	is going away, where it is the last to map them
+ *-------------------------------------------------------------------------
+ */
+LOCAL void bsm_wback(bm_map_t *bmptr)
+{
+	struct	bsio	v[BSIOMAX];
+	pt_t	*pte;
+	int	vpno, i, n;
+
+	for (n=0,vpno=bmptr->bm_vpno ;
+	     vpno < bmptr->bm_vpno + bmptr->bm_npages ; vpno++) {
+		pte = pte_lookup(bmptr->bm_pid, vpno);
+		if (pte == NULL || !pte->pt_pres)
+			continue;
+		i = pte->pt_base - FRAME0;
+		if (i == zero_frm || frm_tab[i].fr_store == FRM_NONE ||
+		    frm_tab[i].fr_refcnt > 1 || !frm_dirty(i))
+			continue;
+		frm_clrdirty(i);
+		v[n].bi_addr = frm_addr(i);
+		v[n].bi_store = frm_tab[i].fr_store;
+		v[n].bi_page = frm_tab[i].fr_pageth;
+		pgs_inc(currpid, ps_wback, 1);
+		if (++n == BSIOMAX) {
+			zs_storev(v, n);
+			n = 0;
+		}
+	}
+	zs_storev(v, n);
 }
 
+/*-------------------------------------------------------------------------
+ * bs_setfresh - mark the first npages of store never written, the rest
+ *	as holding data
+ *-------------------------------------------------------------------------
+ */
+void bs_setfresh(int store, int npages)
+{
+	int	i;
 
+	for (i=0 ; i<NBSPAGES/32 ; i++)
+		bsm_tab[store].bs_fresh[i] = 0;
+	for (i=0 ; i<npages ; i++)
+		bsm_tab[store].bs_fresh[i >> 5] |= 1UL << (i & 31);
+}
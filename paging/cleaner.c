@@ -0,0 +1,87 @@
+/* cleaner.c - pgcleaner, set_dirty_watermarks */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+int	cleanpid = BADPID;		/* id of the page cleaner	*/
+int	dirty_lowat = DIRTYLO;		/* clean down to this many	*/
+int	dirty_hiwat = DIRTYHI;		/* start cleaning above this	*/
+
+LOCAL	int	cl_walk();
+
+/*-------------------------------------------------------------------------
+ * pgcleaner - write dirty pages back ahead of the replacement hand
+ *	so the frames a fault evicts are usually clean
+ *-------------------------------------------------------------------------
+ */
+PROCESS pgcleaner()
+{
+	int	ndirty;
+
+	while (TRUE) {
+		sleep10(CLEANPERIOD);
+		if ((ndirty = cl_walk(0)) <= dirty_hiwat)
+			continue;
+
+		/* walk from the hand, the next pages to be evicted	*/
+		cl_walk(ndirty - dirty_lowat);
+		bsd_wait();
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * cl_walk - go once round the resident ring from the hand, counting the
+ *	dirty pages that could be evicted and writing back the first
+ *	nclean of them; returns how many it found, stopping when it has
+ *	written nclean.  Interrupts are off for one frame at a time, so
+ *	the ring may change under it: a frame that has left it sends
+ *	the walk back to the hand.
+ *-------------------------------------------------------------------------
+ */
+LOCAL int cl_walk(int nclean)
+{
+	STATWORD ps;
+	int	i, n, found;
+
+	disable(ps);
+	i = frm_hand;
+	n = frm_ntype[FR_PAGE];
+	restore(ps);
+	for (found = 0 ; n > 0 && (nclean == 0 || found < nclean) ; n--) {
+		disable(ps);
+		if (i == FRM_NONE || frm_tab[i].fr_qnext == FRM_NONE)
+			i = frm_hand;
+		if (i == FRM_NONE) {
+			restore(ps);
+			break;
+		}
+		if (frm_tab[i].fr_store != FRM_NONE &&
+		    frm_evictable(i) && frm_dirty(i)) {
+			if (nclean > 0)
+				clean_frm(i);
+			found++;
+		}
+		i = frm_tab[i].fr_qnext;
+		restore(ps);
+	}
+	return found;
+}
+
+/*-------------------------------------------------------------------------
+ * set_dirty_watermarks - tune when the page cleaner starts and stops
+ *-------------------------------------------------------------------------
+ */
+SYSCALL set_dirty_watermarks(int lo, int hi)
+{
+	STATWORD ps;
+
+	if (lo < 0 || hi < lo || hi > NFRAMES)
+		return SYSERR;
+	disable(ps);
+	dirty_lowat = lo;
+	dirty_hiwat = hi;
+	restore(ps);
+	return OK;
+}
@@ -1,10 +1,13 @@
 /* control_reg.c - read_cr0 read_cr2 read_cr3 read_cr4
-		   write_cr0 write_cr3 write_cr4 enable_pagine */
+		   write_cr0 write_cr3 write_cr4 enable_pagine rdtsc
+		   cpu_features tlb_flush_page tlb_flush_range */
 
 #include <conf.h>
 #include <kernel.h>
+#include <paging.h>
 
 unsigned long tmp;
+unsigned long tsc_lo, tsc_hi;
 
 
 /*-------------------------------------------------------------------------
@@ -183,8 +186,109 @@ void write_cr4(unsigned long n) {
 void enable_paging(){
   
   unsigned long temp =  read_cr0();
-  temp = temp | ( 0x1 << 31 ) | 0x1;
+  /* WP (bit 16) makes kernel writes fault on read-only (COW) pages */
+  temp = temp | ( 0x1 << 31 ) | ( 0x1 << 16 ) | 0x1;
   write_cr0(temp); 
+
+  /* PGE: global kernel mappings stay in the TLB across CR3 loads */
+  if (pge_on)
+    write_cr4(read_cr4() | CR4_PGE);
+}
+
+
+
+
+/*-------------------------------------------------------------------------
+ * rdtsc - read the time-stamp counter
+ *-------------------------------------------------------------------------
+ */
+unsigned long long rdtsc(void) {
+
+  STATWORD ps;
+  unsigned long long t;
+
+  disable(ps);
+
+  asm("pushl %eax");
+  asm("pushl %edx");
+  asm("rdtsc");                         /* 64-bit count into %edx:%eax */
+  asm("movl %eax, tsc_lo");
+  asm("movl %edx, tsc_hi");
+  asm("popl %edx");
+  asm("popl %eax");
+
+  t = ((unsigned long long) tsc_hi << 32) | tsc_lo;
+
+  restore(ps);
+
+  return t;
+}
+
+
+/*-------------------------------------------------------------------------
+ * cpu_features - CPUID leaf 1 feature flags (EDX)
+ *-------------------------------------------------------------------------
+ */
+unsigned long cpu_features(void) {
+
+  STATWORD ps;
+  unsigned long local_tmp;
+
+  disable(ps);
+
+  asm("pushl %eax");
+  asm("pushl %ebx");
+  asm("pushl %ecx");
+  asm("pushl %edx");
+  asm("movl $1, %eax");
+  asm("cpuid");
+  asm("movl %edx, tmp");
+  asm("popl %edx");
+  asm("popl %ecx");
+  asm("popl %ebx");
+  asm("popl %eax");
+
+  local_tmp = tmp;
+
+  restore(ps);
+
+  return local_tmp;
+}
+
+
+/*-------------------------------------------------------------------------
+ * tlb_flush_page - drop the TLB entry for one virtual address
+ *-------------------------------------------------------------------------
+ */
+void tlb_flush_page(unsigned long vaddr) {
+
+  STATWORD ps;
+
+  disable(ps);
+
+  tmp = vaddr;
+  asm("pushl %eax");
+  asm("movl tmp, %eax");
+  asm("invlpg (%eax)");
+  asm("popl %eax");
+
+  restore(ps);
+
 }
 
 
+/*-------------------------------------------------------------------------
+ * tlb_flush_range - drop the TLB entries for npages from vpno; past
+ *                   TLBRANGEMAX pages one CR3 reload is cheaper (it
+ *                   leaves the global kernel entries alone)
+ *-------------------------------------------------------------------------
+ */
+void tlb_flush_range(int vpno, int npages) {
+
+  if (npages > TLBRANGEMAX) {
+    write_cr3(read_cr3());
+    return;
+  }
+  for ( ; npages > 0 ; npages--, vpno++)
+    tlb_flush_page((unsigned long) vpno * NBPG);
+}
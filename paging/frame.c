@@ -4,27 +4,65 @@
 #include <proc.h>
 #include <paging.h>
 
+fr_map_t frm_tab[NFRAMES];		/* one entry per physical frame	*/
+int	frm_free;			/* head of the free frame list	*/
+int	frm_nfree;			/* length of the free list	*/
+int	frm_ntype[NFRTYPES];		/* in-use frames by fr_type	*/
+int	frm_ndirect;			/* evictions done inside get_frm*/
+int	frm_hash[NFRHASH];		/* (store, pageth) -> frame	*/
+int	zero_frm = FRM_NONE;		/* shared all-zero page		*/
+int	frm_npin;			/* frames pinned by xmlock	*/
+int	frm_rlist[NPROC];		/* each process's resident pages */
+
+#define	frm_hashfn(s, p)	(((s) * NBSPAGES + (p)) % NFRHASH)
+
+LOCAL	void	frm_unhash(), frm_drop();
+
 /*-------------------------------------------------------------------------
  * init_frm - initialize frm_tab
  *-------------------------------------------------------------------------
  */
 SYSCALL init_frm()
 {
-    STATWORD  ps;
-    disable(ps);
-    
-    //for (int i = 0; i < TOTAL_FRAMES; i++)
-    //{
-    //    frame_table[i].status = FRAME_UNMAPPED;
-    //    frame_table[i].owner_pid = -1;
-    //    frame_table[i].virtual_page = 0;
-    //    frame_table[i].reference_count = 0;
-    //    frame_table[i].type = FRAME_PAGE;
-    //    frame_table[i].dirty = 0;               
-    // }
-    
-    restore(ps);
-    return OK;
+	STATWORD ps;
+	int	i;
+
+	disable(ps);
+	for (i=0 ; i<NFRAMES ; i++) {
+		frm_tab[i].fr_status = FRM_UNMAPPED;
+		frm_tab[i].fr_pid = BADPID;
+		frm_tab[i].fr_vpno = 0;
+		frm_tab[i].fr_refcnt = 0;
+		frm_tab[i].fr_type = FR_PAGE;
+		frm_tab[i].fr_dirty = 0;
+		frm_tab[i].fr_io = 0;
+		frm_tab[i].fr_pin = 0;
+		frm_tab[i].fr_rnext = frm_tab[i].fr_rprev = FRM_NONE;
+		frm_tab[i].fr_next = (i == NFRAMES-1) ? FRM_NONE : i+1;
+		frm_tab[i].fr_qnext = frm_tab[i].fr_qprev = FRM_NONE;
+		frm_tab[i].fr_age = 0;
+		frm_tab[i].fr_ltime = 0;
+		frm_tab[i].fr_store = FRM_NONE;
+		frm_tab[i].fr_pageth = 0;
+		frm_tab[i].fr_hnext = FRM_NONE;
+		frm_tab[i].fr_npte = 0;
+	}
+	for (i=0 ; i<NFRHASH ; i++)
+		frm_hash[i] = FRM_NONE;
+	for (i=0 ; i<NPROC ; i++)
+		frm_rlist[i] = FRM_NONE;
+	frm_free = 0;
+	frm_nfree = NFRAMES;
+	frm_npin = 0;
+	frm_hand = FRM_NONE;
+	for (i=0 ; i<NFRTYPES ; i++)
+		frm_ntype[i] = 0;
+
+	/* held for good: never on the resident ring or the hash	*/
+	get_frm(&zero_frm);
+	bzero(frm_addr(zero_frm), NBPG);
+	restore(ps);
+	return OK;
 }
 
 
@@ -34,20 +72,532 @@ SYSCALL init_frm()
  */
 SYSCALL get_frm(int* avail)
 {
-  kprintf("To be implemented!\n");
-  return OK;
+	STATWORD ps;
+	int	i;
+
+	disable(ps);
+	if (frm_free == FRM_NONE) {		/* reserve ran dry	*/
+		if ((i = pgpolicy->pp_victim()) == SYSERR ||
+		    evict_frm(i) == SYSERR) {
+			restore(ps);
+			return SYSERR;
+		}
+		frm_ndirect++;
+	}
+	i = frm_free;
+	frm_free = frm_tab[i].fr_next;
+	frm_nfree--;
+	frm_tab[i].fr_next = FRM_NONE;
+	frm_tab[i].fr_status = FRM_MAPPED;
+	frm_tab[i].fr_type = FR_PAGE;
+	frm_tab[i].fr_pid = BADPID;
+	frm_tab[i].fr_refcnt = 0;
+	frm_tab[i].fr_dirty = 0;
+	frm_tab[i].fr_io = 0;
+	frm_tab[i].fr_pin = 0;
+	frm_tab[i].fr_store = FRM_NONE;
+	frm_tab[i].fr_npte = 0;
+	frm_ntype[FR_PAGE]++;
+	*avail = i;
+	if (frm_nfree < frm_lowat && rclpid != BADPID && scount(rclsem) < 0)
+		signalnr(rclsem, 1);		/* the next resched runs it */
+	restore(ps);
+	return OK;
 }
 
 /*-------------------------------------------------------------------------
- * free_frm - free a frame 
+ * set_frm - record the owner and use of a frame returned by get_frm
+ *-------------------------------------------------------------------------
+ */
+void set_frm(int i, int pid, int vpno, int type)
+{
+	STATWORD ps;
+	fr_map_t *fptr;
+
+	disable(ps);
+	fptr = &frm_tab[i];
+	frm_ntype[fptr->fr_type]--;
+	frm_ntype[type]++;
+	fptr->fr_type = type;
+	if (type == FR_PAGE)
+		frm_charge(i, pid);
+	else
+		fptr->fr_pid = pid;
+	fptr->fr_vpno = vpno;
+	fptr->fr_refcnt = 1;
+	if (type == FR_PAGE && fptr->fr_qnext == FRM_NONE)
+		pol_insert(i);
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * free_frm - free a frame
  *-------------------------------------------------------------------------
  */
 SYSCALL free_frm(int i)
 {
+	STATWORD ps;
+	fr_map_t *fptr;
+
+	if (i < 0 || i >= NFRAMES)
+		return SYSERR;
+	disable(ps);
+	fptr = &frm_tab[i];
+	if (fptr->fr_status == FRM_UNMAPPED) {
+		restore(ps);
+		return SYSERR;
+	}
+	frm_drop(i);
+	fptr->fr_next = frm_free;
+	frm_free = i;
+	frm_nfree++;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_drop - forget what frame i holds, short of putting it on the
+ *	free list
+ *-------------------------------------------------------------------------
+ */
+LOCAL void frm_drop(int i)
+{
+	fr_map_t *fptr = &frm_tab[i];
+
+	if (fptr->fr_qnext != FRM_NONE)
+		pol_remove(i);
+	if (fptr->fr_store != FRM_NONE)
+		frm_unhash(i);
+	if (fptr->fr_type == FR_PAGE)
+		frm_charge(i, BADPID);
+	frm_ntype[fptr->fr_type]--;
+	fptr->fr_status = FRM_UNMAPPED;
+	fptr->fr_pid = BADPID;
+	fptr->fr_vpno = 0;
+	fptr->fr_refcnt = 0;
+	fptr->fr_type = FR_PAGE;
+	fptr->fr_dirty = 0;
+	fptr->fr_io = 0;			/* its waiters will retry */
+	if (fptr->fr_pin > 0) {
+		fptr->fr_pin = 0;
+		frm_npin--;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * frm_charge - charge the page in frame i to pid (BADPID: to nobody),
+ *	moving it to pid's resident list and count
+ *-------------------------------------------------------------------------
+ */
+void frm_charge(int i, int pid)
+{
+	fr_map_t *fptr = &frm_tab[i];
+
+	if (fptr->fr_pid != BADPID) {
+		if (fptr->fr_rprev != FRM_NONE)
+			frm_tab[fptr->fr_rprev].fr_rnext = fptr->fr_rnext;
+		else
+			frm_rlist[fptr->fr_pid] = fptr->fr_rnext;
+		if (fptr->fr_rnext != FRM_NONE)
+			frm_tab[fptr->fr_rnext].fr_rprev = fptr->fr_rprev;
+		proctab[fptr->fr_pid].prss--;
+	}
+	fptr->fr_pid = pid;
+	fptr->fr_rprev = FRM_NONE;
+	fptr->fr_rnext = FRM_NONE;
+	if (pid != BADPID) {
+		if ((fptr->fr_rnext = frm_rlist[pid]) != FRM_NONE)
+			frm_tab[fptr->fr_rnext].fr_rprev = i;
+		frm_rlist[pid] = i;
+		proctab[pid].prss++;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * frm_teardown - give back the pages of a dying process that nobody
+ *	else maps: dirty ones a shared store keeps are written back
+ *	together, then all are unmapped and go on the free list at
+ *	once.  bsm_unmapall is left the shared pages and swap slots.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL frm_teardown(int pid)
+{
+	STATWORD ps;
+	struct	bsio	v[BSIOMAX];
+	fr_map_t *fptr;
+	pt_t	*pte;
+	int	i, next, head, tail, n, m, p, vpno;
+
+	disable(ps);
+	for (n=0,i=frm_rlist[pid] ; i != FRM_NONE ; i = fptr->fr_rnext) {
+		fptr = &frm_tab[i];
+		if (fptr->fr_refcnt > 1 || fptr->fr_store == FRM_NONE ||
+		    bsm_tab[fptr->fr_store].bs_private || !frm_dirty(i))
+			continue;
+		frm_clrdirty(i);
+		v[n].bi_addr = frm_addr(i);
+		v[n].bi_store = fptr->fr_store;
+		v[n].bi_page = fptr->fr_pageth;
+		pgs_inc(currpid, ps_wback, 1);
+		if (++n == BSIOMAX) {
+			zs_storev(v, n);
+			n = 0;
+		}
+	}
+	zs_storev(v, n);
+
+	head = tail = FRM_NONE;
+	for (n=0,i=frm_rlist[pid] ; i != FRM_NONE ; i = next) {
+		fptr = &frm_tab[i];
+		next = fptr->fr_rnext;
+		if (fptr->fr_refcnt > 1)
+			continue;
+		m = BM_NONE;
+		if ((pte = frm_pte(i, &m, &p, &vpno)) != NULL) {
+			pte->pt_pres = 0;
+			pte->pt_dirty = 0;
+			pt_release(pid, vpno);
+		}
+		if (fptr->fr_pin > 0)
+			pgs_inc(pid, ps_pinned, -1);
+		frm_drop(i);
+		fptr->fr_next = head;
+		head = i;
+		if (tail == FRM_NONE)
+			tail = i;
+		n++;
+	}
+	if (n > 0) {
+		frm_tab[tail].fr_next = frm_free;
+		frm_free = head;
+		frm_nfree += n;
+	}
+	if (pid == currpid)			/* a suicide: flush all	*/
+		write_cr3(read_cr3());
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_setstore - record that frame i caches page pageth of store
+ *-------------------------------------------------------------------------
+ */
+void frm_setstore(int i, int store, int pageth)
+{
+	STATWORD ps;
+	int	h;
+
+	disable(ps);
+	h = frm_hashfn(store, pageth);
+	frm_tab[i].fr_store = store;
+	frm_tab[i].fr_pageth = pageth;
+	frm_tab[i].fr_hnext = frm_hash[h];
+	frm_hash[h] = i;
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * frm_unhash - forget the store page cached in frame i
+ *-------------------------------------------------------------------------
+ */
+LOCAL void frm_unhash(int i)
+{
+	int	*link;
+
+	link = &frm_hash[frm_hashfn(frm_tab[i].fr_store, frm_tab[i].fr_pageth)];
+	for ( ; *link != FRM_NONE ; link = &frm_tab[*link].fr_hnext)
+		if (*link == i) {
+			*link = frm_tab[i].fr_hnext;
+			break;
+		}
+	frm_tab[i].fr_store = FRM_NONE;
+	frm_tab[i].fr_hnext = FRM_NONE;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_find - find the frame caching page pageth of store, if resident
+ *-------------------------------------------------------------------------
+ */
+int frm_find(int store, int pageth)
+{
+	int	i;
+
+	for (i = frm_hash[frm_hashfn(store, pageth)] ; i != FRM_NONE ;
+	     i = frm_tab[i].fr_hnext)
+		if (frm_tab[i].fr_store == store &&
+		    frm_tab[i].fr_pageth == pageth)
+			return i;
+	return FRM_NONE;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_pte - return the next page table entry mapping frame i, with the
+ *	process and virtual page it maps.  *cur starts at BM_NONE and
+ *	walks the mappings of the frame's store; a private frame is
+ *	mapped only by fr_pid.
+ *-------------------------------------------------------------------------
+ */
+pt_t *frm_pte(int i, int *cur, int *pid, int *vpno)
+{
+	fr_map_t *fptr = &frm_tab[i];
+	bm_map_t *mptr;
+	pt_t	*pte;
+	int	m;
+
+	if (fptr->fr_store == FRM_NONE) {
+		if (*cur != BM_NONE)
+			return NULL;
+		*cur = NBSMAPS;
+		*pid = fptr->fr_pid;
+		*vpno = fptr->fr_vpno;
+		pte = pte_lookup(*pid, *vpno);
+		return (pte != NULL && pte->pt_pres &&
+			pte->pt_base == FRAME0 + i) ? pte : NULL;
+	}
+	m = (*cur == BM_NONE) ? bsm_tab[fptr->fr_store].bs_maps :
+		(*cur < NBSMAPS ? bsmaps[*cur].bm_snext : BM_NONE);
+	for ( ; m != BM_NONE ; m = mptr->bm_snext) {
+		mptr = &bsmaps[m];
+		if (fptr->fr_pageth >= mptr->bm_npages)
+			continue;
+		pte = pte_lookup(mptr->bm_pid, mptr->bm_vpno + fptr->fr_pageth);
+		if (pte != NULL && pte->pt_pres && pte->pt_base == FRAME0 + i) {
+			*cur = m;
+			*pid = mptr->bm_pid;
+			*vpno = mptr->bm_vpno + fptr->fr_pageth;
+			return pte;
+		}
+	}
+	*cur = NBSMAPS;
+	return NULL;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_evictable - may the replacement policy take frame i?
+ *	A private copy-on-write page has only the swap area to go to,
+ *	a page still being read in has processes waiting on it, a pinned
+ *	page stays, and a process down to its setfrmquota minimum keeps
+ *	what it has.
+ *-------------------------------------------------------------------------
+ */
+int frm_evictable(int i)
+{
+	fr_map_t *fptr = &frm_tab[i];
 
-  kprintf("To be implemented!\n");
-  return OK;
+	if (fptr->fr_io || fptr->fr_pin)
+		return FALSE;
+	if (fptr->fr_store == FRM_NONE &&	/* the zero page, too	*/
+	    (i == zero_frm || fptr->fr_pid == BADPID || sw_full()))
+		return FALSE;
+	return fptr->fr_pid == BADPID ||
+	       proctab[fptr->fr_pid].prss > proctab[fptr->fr_pid].pfrmmin;
 }
 
+/*-------------------------------------------------------------------------
+ * frm_pin - pin frame i once more; SYSERR if it is not pinned yet and
+ *	NFRPIN frames are, so that enough are left to page with
+ *-------------------------------------------------------------------------
+ */
+SYSCALL frm_pin(int i)
+{
+	STATWORD ps;
+	fr_map_t *fptr = &frm_tab[i];
 
+	disable(ps);
+	if (fptr->fr_pin == 0) {
+		if (frm_npin >= NFRPIN) {
+			restore(ps);
+			return SYSERR;
+		}
+		frm_npin++;
+	}
+	fptr->fr_pin++;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_unpin - drop one pin of frame i
+ *-------------------------------------------------------------------------
+ */
+void frm_unpin(int i)
+{
+	STATWORD ps;
+	fr_map_t *fptr = &frm_tab[i];
+
+	disable(ps);
+	if (fptr->fr_pin > 0 && --fptr->fr_pin == 0)
+		frm_npin--;
+	restore(ps);
+}
 
+/*-------------------------------------------------------------------------
+ * evict_frm - write back a resident page if dirty, unmap it from every
+ *	process sharing it, and free the frame.  A dirty heap page may
+ *	go to a swap slot instead, which its entry then names; a private
+ *	copy always does.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL evict_frm(int i)
+{
+	STATWORD ps;
+	fr_map_t *fptr;
+	int	slot;
+
+	if (i < 0 || i >= NFRAMES)
+		return SYSERR;
+	disable(ps);
+	fptr = &frm_tab[i];
+	if (fptr->fr_status != FRM_MAPPED || fptr->fr_type != FR_PAGE ||
+	    !frm_evictable(i)) {
+		restore(ps);
+		return SYSERR;
+	}
+	slot = SYSERR;
+	if (fptr->fr_store == FRM_NONE) {
+		if ((slot = sw_out(i)) == SYSERR) {
+			restore(ps);
+			return SYSERR;
+		}
+	} else if (frm_dirty(i) && (slot = sw_out(i)) == SYSERR)
+		clean_frm(i);
+	frm_unmap(i, slot);
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_unmap - unmap the page in frame i from every process sharing it
+ *	and free the frame; the entries name swap slot if it is not
+ *	SYSERR, and then keep their hold on the page table
+ *-------------------------------------------------------------------------
+ */
+void frm_unmap(int i, int slot)
+{
+	STATWORD ps;
+	pt_t	*pte;
+	int	m, pid, vpno;
+
+	disable(ps);
+	pgs_inc(currpid, ps_evict, 1);
+	for (m = BM_NONE ; (pte = frm_pte(i, &m, &pid, &vpno)) != NULL ; ) {
+		pte->pt_pres = 0;
+		pte->pt_dirty = 0;
+		tlb_shoot(pid, vpno, 1);
+		if (slot != SYSERR) {
+			pte->pt_avail = PT_SWAP;
+			pte->pt_base = slot;
+		} else
+			pt_release(pid, vpno);
+	}
+	free_frm(i);
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * clean_frm - write the page held in frame i to its backing store
+ *-------------------------------------------------------------------------
+ */
+SYSCALL clean_frm(int i)
+{
+	STATWORD ps;
+	fr_map_t *fptr;
+
+	disable(ps);
+	fptr = &frm_tab[i];
+	if (fptr->fr_status != FRM_MAPPED || fptr->fr_type != FR_PAGE ||
+	    fptr->fr_store == FRM_NONE) {
+		restore(ps);
+		return SYSERR;
+	}
+	frm_clrdirty(i);
+	zs_store(frm_addr(i), fptr->fr_store, fptr->fr_pageth);
+	pgs_inc(currpid, ps_wback, 1);
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_dirty - has the page held in frame i been modified?
+ *-------------------------------------------------------------------------
+ */
+int frm_dirty(int i)
+{
+	pt_t	*pte;
+	int	m, pid, vpno;
+
+	if (frm_tab[i].fr_dirty)
+		return TRUE;
+	for (m = BM_NONE ; (pte = frm_pte(i, &m, &pid, &vpno)) != NULL ; )
+		if (pte->pt_dirty)
+			return TRUE;
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_clrdirty - mark the page held in frame i clean
+ *-------------------------------------------------------------------------
+ */
+void frm_clrdirty(int i)
+{
+	pt_t	*pte;
+	int	m, pid, vpno;
+
+	frm_tab[i].fr_dirty = 0;
+	for (m = BM_NONE ; (pte = frm_pte(i, &m, &pid, &vpno)) != NULL ; )
+		if (pte->pt_dirty) {
+			pte->pt_dirty = 0;
+			tlb_shoot(pid, vpno, 1);
+		}
+}
+
+/*-------------------------------------------------------------------------
+ * frm_testacc - test (and optionally clear) the referenced bits of frame i.
+ *	ws_window may have moved a reference into PT_POLREF; one cleared
+ *	here is kept in PT_WSREF for ws_window.
+ *-------------------------------------------------------------------------
+ */
+int frm_testacc(int i, int clear)
+{
+	pt_t	*pte;
+	int	m, pid, vpno, acc;
+
+	acc = FALSE;
+	for (m = BM_NONE ; (pte = frm_pte(i, &m, &pid, &vpno)) != NULL ; )
+		if (pte->pt_acc || (pte->pt_avail & PT_POLREF)) {
+			acc = TRUE;
+			if (!clear)
+				break;
+			if (pte->pt_acc) {
+				pte->pt_avail |= PT_WSREF;
+				pte->pt_acc = 0;
+				tlb_shoot(pid, vpno, 1);
+			}
+			pte->pt_avail &= ~PT_POLREF;
+		}
+	return acc;
+}
+
+/*-------------------------------------------------------------------------
+ * frm_stats - report frame usage from the running counters
+ *-------------------------------------------------------------------------
+ */
+SYSCALL frm_stats(struct frmstat *fs)
+{
+	STATWORD ps;
+
+	if (fs == NULL)
+		return SYSERR;
+	disable(ps);
+	fs->fs_free = frm_nfree;
+	fs->fs_used = NFRAMES - frm_nfree;
+	fs->fs_page = frm_ntype[FR_PAGE];
+	fs->fs_tbl = frm_ntype[FR_TBL];
+	fs->fs_dir = frm_ntype[FR_DIR];
+	fs->fs_direct = frm_ndirect;
+	fs->fs_bgwake = rcl_nwake;
+	fs->fs_bgpages = rcl_npages;
+	fs->fs_pinned = frm_npin;
+	restore(ps);
+	return OK;
+}
@@ -6,8 +6,27 @@
 int get_bs(bsd_t bs_id, unsigned int npages) {
 
   /* requests a new mapping of npages with ID map_id */
-    kprintf("To be implemented!\n");
-    return npages;
+	STATWORD ps;
+	bs_map_t *bsptr;
+	int	n;
+
+	if (bs_id >= NBS || npages == 0 || npages > NBSPAGES)
+		return SYSERR;
+	disable(ps);
+	bsptr = &bsm_tab[bs_id];
+	if (bsptr->bs_status == BSM_MAPPED) {
+		n = bsptr->bs_private ? SYSERR : bsptr->bs_npages;
+		restore(ps);
+		return n;
+	}
+	if (bs_extalloc(bs_id, npages) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	bsptr->bs_status = BSM_MAPPED;
+	bsptr->bs_pid = currpid;
+	restore(ps);
+	return npages;
 
 }
 
@@ -0,0 +1,199 @@
+/* pagetab.c - init_gpt, pd_alloc, pd_free, pte_lookup, pte_alloc,
+		pt_hold, pt_release */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+int	gpt_frm[NGPT];			/* page tables for the first 16M */
+int	pse_on;				/* ... or 4 MB pages instead	*/
+int	pge_on;				/* CPU keeps global TLB entries	*/
+
+/*-------------------------------------------------------------------------
+ * init_gpt - set up the identity mapping of the first NGPT*4 MB of
+ *	physical memory shared by every page directory: 4 MB pages if
+ *	the CPU has PSE, otherwise page tables built here.  If the CPU
+ *	has PGE the mappings are global, so they survive the CR3 reload
+ *	of a context switch.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL init_gpt()
+{
+	pt_t	*pt;
+	int	i, j;
+
+	pge_on = (cpu_features() & CPU_PGE) != 0;
+	if (cpu_features() & CPU_PSE) {
+		write_cr4(read_cr4() | CR4_PSE);
+		pse_on = TRUE;
+		return OK;
+	}
+	for (i=0 ; i<NGPT ; i++) {
+		if (get_frm(&gpt_frm[i]) == SYSERR)
+			return SYSERR;
+		set_frm(gpt_frm[i], BADPID, i, FR_TBL);
+		pgs_inc(BADPID, ps_ptalloc, 1);
+		pt = (pt_t *) frm_addr(gpt_frm[i]);
+		bzero(pt, NBPG);
+		for (j=0 ; j<NPTE ; j++) {
+			pt[j].pt_pres = 1;
+			pt[j].pt_write = 1;
+			pt[j].pt_global = pge_on;
+			pt[j].pt_base = i * NPTE + j;
+		}
+	}
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * pd_alloc - build a page directory for pid, sharing the global
+ *	mapping of the first NGPT*4 MB
+ *-------------------------------------------------------------------------
+ */
+SYSCALL pd_alloc(int pid)
+{
+	STATWORD ps;
+	pd_t	*pd;
+	int	pdfrm;
+	int	i;
+
+	disable(ps);
+	if (get_frm(&pdfrm) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	set_frm(pdfrm, pid, 0, FR_DIR);
+	pd = (pd_t *) frm_addr(pdfrm);
+	bzero(pd, NBPG);
+	proctab[pid].pdbr = (unsigned long) pd;
+	for (i=0 ; i<NGPT ; i++) {
+		pd[i].pd_pres = 1;
+		pd[i].pd_write = 1;
+		pd[i].pd_global = pge_on;
+		if (pse_on) {
+			pd[i].pd_fmb = 1;
+			pd[i].pd_base = i * NPTE;
+		} else
+			pd[i].pd_base = FRAME0 + gpt_frm[i];
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * pd_free - release pid's own page tables and page directory
+ *-------------------------------------------------------------------------
+ */
+SYSCALL pd_free(int pid)
+{
+	STATWORD ps;
+	pd_t	*pd;
+	int	i;
+
+	disable(ps);
+	if ((pd = (pd_t *) proctab[pid].pdbr) == NULL) {
+		restore(ps);
+		return SYSERR;
+	}
+	for (i=NGPT ; i<NPTE ; i++)
+		if (pd[i].pd_pres)
+			free_frm(pd[i].pd_base - FRAME0);
+	free_frm(frm_id(pd));
+	proctab[pid].pdbr = 0;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * pte_lookup - find the page table entry mapping vpno in pid's space
+ *	(none for a 4 MB page)
+ *-------------------------------------------------------------------------
+ */
+pt_t *pte_lookup(int pid, int vpno)
+{
+	pd_t	*pd;
+	pt_t	*pt;
+
+	if (pid < 0 || pid >= NPROC || proctab[pid].pdbr == 0)
+		return NULL;
+	pd = (pd_t *) proctab[pid].pdbr + (vpno >> 10);
+	if (!pd->pd_pres || pd->pd_fmb)
+		return NULL;
+	pt = (pt_t *) (pd->pd_base * NBPG);
+	return pt + (vpno & 0x3ff);
+}
+
+/*-------------------------------------------------------------------------
+ * pte_alloc - like pte_lookup, but create the page table if missing.
+ *	A new table is empty: the caller must pt_hold it before anything
+ *	that could free it again.
+ *-------------------------------------------------------------------------
+ */
+pt_t *pte_alloc(int pid, int vpno)
+{
+	STATWORD ps;
+	pd_t	*pd;
+	pt_t	*pt;
+	int	ptfrm;
+
+	disable(ps);
+	if ((pt = pte_lookup(pid, vpno)) != NULL) {
+		restore(ps);
+		return pt;
+	}
+	if (proctab[pid].pdbr == 0 || (vpno >> 10) < NGPT ||
+	    get_frm(&ptfrm) == SYSERR) {
+		restore(ps);
+		return NULL;
+	}
+	set_frm(ptfrm, pid, vpno >> 10, FR_TBL);
+	pgs_inc(pid, ps_ptalloc, 1);
+	pt = (pt_t *) frm_addr(ptfrm);
+	bzero(pt, NBPG);
+	pd = (pd_t *) proctab[pid].pdbr + (vpno >> 10);
+	pd->pd_pres = 1;
+	pd->pd_write = 1;
+	pd->pd_base = FRAME0 + ptfrm;
+	restore(ps);
+	return pt + (vpno & 0x3ff);
+}
+
+/*
+ * fr_npte of a page table frame counts its present entries plus the
+ * holds of faults still filling one in.  Whoever makes an entry
+ * present keeps a hold for it; whoever clears one drops it, and the
+ * table goes back to the frame pool when the count reaches zero.
+ */
+
+/*-------------------------------------------------------------------------
+ * pt_hold - count one more user of the page table covering vpno
+ *-------------------------------------------------------------------------
+ */
+void pt_hold(int pid, int vpno)
+{
+	pd_t	*pd;
+
+	pd = (pd_t *) proctab[pid].pdbr + (vpno >> 10);
+	frm_tab[pd->pd_base - FRAME0].fr_npte++;
+}
+
+/*-------------------------------------------------------------------------
+ * pt_release - drop a use of the page table covering vpno, freeing
+ *	the table once nothing holds it
+ *-------------------------------------------------------------------------
+ */
+void pt_release(int pid, int vpno)
+{
+	pd_t	*pd;
+	int	ptfrm;
+
+	pd = (pd_t *) proctab[pid].pdbr + (vpno >> 10);
+	ptfrm = pd->pd_base - FRAME0;
+	if (--frm_tab[ptfrm].fr_npte > 0)
+		return;
+	pd->pd_pres = 0;
+	pd->pd_base = 0;
+	free_frm(ptfrm);
+	tlb_shoot(pid, vpno, 1);
+}
@@ -1,9 +1,13 @@
-/* pfint.c - pfint */
+/* pfint.c - pfint, pgin, pgin_v, pgout, cow_break, zfill */
 
 #include <conf.h>
 #include <kernel.h>
+#include <proc.h>
 #include <paging.h>
 
+extern unsigned long pferrcode;
+
+LOCAL	int	pf_serve();
 
 /*-------------------------------------------------------------------------
  * pfint - paging fault ISR
@@ -11,9 +15,333 @@
  */
 SYSCALL pfint()
 {
+	STATWORD ps;
+	unsigned long long t0;
+	unsigned long vaddr;
+	int	major;
+
+	t0 = rdtsc();
+	disable(ps);
+	vaddr = read_cr2();
+	major = pf_serve(vaddr);
+	if (major != SYSERR)
+		bsd_wait();		/* the I/O it did takes time	*/
+	pgs_fault(currpid, major == TRUE, rdtsc() - t0);
+	if (major == SYSERR) {
+		kill(currpid);
+		restore(ps);
+		return SYSERR;
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * pf_serve - resolve a fault on vaddr for currpid; returns TRUE if the
+ *	page had to be read from the backing store, FALSE if not, and
+ *	SYSERR if the process has to go
+ *-------------------------------------------------------------------------
+ */
+LOCAL int pf_serve(unsigned long vaddr)
+{
+	unsigned long rdbytes;
+	pt_t	*pte;
+	int	vpno, m, store, pageth, i;
+
+	vpno = vaddr / NBPG;
+	if ((m = bsm_find(currpid, vpno)) == SYSERR) {
+		kprintf("pfint: pid %d illegal access to 0x%08x\n",
+			currpid, vaddr);
+		return SYSERR;
+	}
+	store = bsmaps[m].bm_store;
+	pageth = vpno - bsmaps[m].bm_vpno;
+
+	/* first write to a heap page: no need to read the store	*/
+	if ((pferrcode & PF_WRITE) && bs_isfresh(store, pageth)) {
+		if (zfill(currpid, vpno, store, pageth) == SYSERR) {
+			kprintf("pfint: pid %d out of frames\n", currpid);
+			return SYSERR;
+		}
+		return FALSE;
+	}
+
+	/* a write to a present read-only page: copy-on-write	*/
+	if (pferrcode & PF_PROT) {
+		if (!(pferrcode & PF_WRITE) ||
+		    !bsmaps[m].bm_cow ||
+		    cow_break(currpid, vpno) == SYSERR) {
+			kprintf("pfint: pid %d bad write to 0x%08x\n",
+				currpid, vaddr);
+			return SYSERR;
+		}
+		return FALSE;
+	}
+
+	/* over its allotment: the process pays with one of its own pages */
+	proctab[currpid].pflts++;
+	if (proctab[currpid].prss >= proctab[currpid].ptarget)
+		frm_trim(currpid);
+
+	/* someone is reading the page in already: wait for that read	*/
+	if ((i = frm_find(store, pageth)) != FRM_NONE && frm_tab[i].fr_io)
+		frm_wait(i);
+	rdbytes = pg_pstats[currpid].ps_rdbytes;
+	if (pgin(currpid, vpno, store, pageth) == SYSERR) {
+		kprintf("pfint: pid %d out of frames\n", currpid);
+		return SYSERR;
+	}
+	rdbytes = pg_pstats[currpid].ps_rdbytes - rdbytes;
+	readahead(currpid, vpno, store, pageth);
+
+	/* and for ours: others run, or wait on it too, meanwhile	*/
+	if ((pte = pte_lookup(currpid, vpno)) != NULL && pte->pt_pres &&
+	    frm_tab[pte->pt_base - FRAME0].fr_io)
+		frm_wait(pte->pt_base - FRAME0);
+	return rdbytes != 0;
+}
+
+/*-------------------------------------------------------------------------
+ * pgin - map page pageth of store at vpno for pid, sharing the frame
+ *	if the page is already resident; copy-on-write mappings and
+ *	never-written pages (mapped to the zero page) get it read-only.
+ *	A page evicted to swap comes back from its slot.  One read from
+ *	the store stays in transit until the device is done with it.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL pgin(int pid, int vpno, int store, int pageth)
+{
+	STATWORD ps;
+	struct	bsio	io;
+	unsigned long owed;
+	int	n;
+
+	disable(ps);
+	n = 0;
+	if (pgin_v(pid, vpno, store, pageth, &io, &n) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	owed = bsd_owed(currpid);
+	zs_loadv(&io, n);
+	if (n > 0 && bsd_owed(currpid) != owed)	/* went to the device	*/
+		frm_transit(frm_id(io.bi_addr), bsd_owed(currpid));
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * pgin_v - pgin, but a page that has to be loaded is queued at v[*n]
+ *	rather than read.  Its frame is mapped already, so the caller
+ *	must zs_loadv the queue before anything else can run.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL pgin_v(int pid, int vpno, int store, int pageth, struct bsio *v,
+	       int *n)
+{
+	STATWORD ps;
+	int	i, m;
+	pt_t	*pte;
+
+	disable(ps);
+	if ((m = bsm_find(pid, vpno)) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+
+	/* the page table first: getting it may evict the shared page */
+	if ((pte = pte_alloc(pid, vpno)) == NULL) {
+		restore(ps);
+		return SYSERR;
+	}
+	if (pte->pt_pres) {
+		restore(ps);
+		return OK;
+	}
+	if (pte->pt_avail & PT_SWAP) {
+		i = sw_in(pid, vpno);
+		restore(ps);
+		return i;
+	}
+	pt_hold(pid, vpno);			/* for the new entry	*/
+	if (bs_isfresh(store, pageth)) {
+		pte->pt_pres = 1;
+		pte->pt_write = 0;
+		pte->pt_acc = 0;
+		pte->pt_dirty = 0;
+		pte->pt_base = FRAME0 + zero_frm;
+		restore(ps);
+		return OK;
+	}
+	if ((i = frm_find(store, pageth)) != FRM_NONE) {
+		frm_tab[i].fr_refcnt++;
+	} else {
+		if (get_frm(&i) == SYSERR) {
+			pt_release(pid, vpno);
+			restore(ps);
+			return SYSERR;
+		}
+		set_frm(i, pid, vpno, FR_PAGE);
+		frm_setstore(i, store, pageth);
+		v[*n].bi_addr = frm_addr(i);
+		v[*n].bi_store = store;
+		v[*n].bi_page = pageth;
+		(*n)++;
+	}
+	pte->pt_pres = 1;
+	pte->pt_write = !bsmaps[m].bm_cow;
+	pte->pt_acc = 0;
+	pte->pt_dirty = 0;
+	pte->pt_base = FRAME0 + i;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * pgout - drop pid's mapping of vpno.  The frame (or swap slot) goes
+ *	when its last mapping does, written back first if wback is set
+ *	and it is dirty.  A pin pid holds on the page goes with it.
+ *	The caller flushes the TLB, so a range is flushed once.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL pgout(int pid, int vpno, int wback)
+{
+	STATWORD ps;
+	fr_map_t *fptr;
+	pt_t	*pte;
+	int	i, m, vpn, owner;
+
+	disable(ps);
+	pte = pte_lookup(pid, vpno);
+	if (pte != NULL && !pte->pt_pres && (pte->pt_avail & PT_SWAP))
+		sw_free(pid, vpno, wback);
+	if (pte == NULL || !pte->pt_pres) {
+		restore(ps);
+		return OK;
+	}
+	i = pte->pt_base - FRAME0;
+	fptr = &frm_tab[i];
+	if (fptr->fr_pin > 0)
+		xm_unpin(pid, vpno);
+	if (pte->pt_dirty)
+		fptr->fr_dirty = 1;
+	pte->pt_pres = 0;
+	pte->pt_dirty = 0;
+	pt_release(pid, vpno);
+	if (i == zero_frm) {
+		restore(ps);
+		return OK;
+	}
+	if (fptr->fr_store == FRM_NONE || --fptr->fr_refcnt <= 0) {
+		if (wback && fptr->fr_store != FRM_NONE && fptr->fr_dirty)
+			clean_frm(i);
+		free_frm(i);
+	} else if (fptr->fr_pid == pid) {
+		/* charge the frame to a process still mapping it	*/
+		frm_charge(i, BADPID);
+		m = BM_NONE;
+		if (frm_pte(i, &m, &owner, &vpn) != NULL)
+			frm_charge(i, owner);
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * cow_break - give pid a private, writable copy of the shared page
+ *	it has mapped read-only at vpno; an xmlock on it moves to the copy
+ *-------------------------------------------------------------------------
+ */
+SYSCALL cow_break(int pid, int vpno)
+{
+	STATWORD ps;
+	pt_t	*pte;
+	int	old, new, store, pageth, m, pinned;
 
-  kprintf("To be implemented!\n");
-  return OK;
+	disable(ps);
+	pte = pte_lookup(pid, vpno);
+	if (pte == NULL || !pte->pt_pres) {
+		restore(ps);
+		return SYSERR;
+	}
+	old = pte->pt_base - FRAME0;
+	store = frm_tab[old].fr_store;
+	pageth = frm_tab[old].fr_pageth;
+	if (store == FRM_NONE) {		/* already private	*/
+		pte->pt_write = 1;
+		tlb_shoot(pid, vpno, 1);
+		restore(ps);
+		return OK;
+	}
+	pt_hold(pid, vpno);		/* becomes the new entry's	*/
+	if (get_frm(&new) == SYSERR) {
+		pt_release(pid, vpno);
+		restore(ps);
+		return SYSERR;
+	}
+
+	/* getting the frame may have evicted the shared page	*/
+	pinned = FALSE;
+	if (pte->pt_pres) {
+		m = bsm_find(pid, vpno);
+		pinned = m != SYSERR &&
+			 bm_ispinned(m, vpno - bsmaps[m].bm_vpno);
+		bcopy(frm_addr(old), frm_addr(new), NBPG);
+		pgout(pid, vpno, TRUE);
+	} else
+		zs_load(frm_addr(new), store, pageth);
+	set_frm(new, pid, vpno, FR_PAGE);
+	pte->pt_pres = 1;
+	pte->pt_write = 1;
+	pte->pt_acc = 1;
+	pte->pt_dirty = 1;
+	pte->pt_base = FRAME0 + new;
+	tlb_shoot(pid, vpno, 1);
+	if (pinned && frm_pin(new) != SYSERR) {	/* pgout dropped it	*/
+		bm_setpin(m, vpno - bsmaps[m].bm_vpno);
+		pgs_inc(pid, ps_pinned, 1);
+	}
+	restore(ps);
+	return OK;
 }
 
+/*-------------------------------------------------------------------------
+ * zfill - give pid a zeroed frame for the never-written page pageth of
+ *	store at vpno, replacing any read-only mapping of the zero page.
+ *	The page is no longer fresh, so the frame is dirty until the
+ *	zeros reach the store.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL zfill(int pid, int vpno, int store, int pageth)
+{
+	STATWORD ps;
+	pt_t	*pte;
+	int	i;
 
+	disable(ps);
+	if ((pte = pte_alloc(pid, vpno)) == NULL) {
+		restore(ps);
+		return SYSERR;
+	}
+	if (!pte->pt_pres)			/* no zero page mapped	*/
+		pt_hold(pid, vpno);
+	if (get_frm(&i) == SYSERR) {
+		if (!pte->pt_pres)
+			pt_release(pid, vpno);
+		restore(ps);
+		return SYSERR;
+	}
+	bzero(frm_addr(i), NBPG);
+	set_frm(i, pid, vpno, FR_PAGE);
+	frm_setstore(i, store, pageth);
+	bs_clrfresh(store, pageth);
+	frm_tab[i].fr_dirty = 1;		/* the store has old data	*/
+	pte->pt_pres = 1;
+	pte->pt_write = 1;
+	pte->pt_acc = 0;
+	pte->pt_dirty = 0;
+	pte->pt_base = FRAME0 + i;
+	tlb_shoot(pid, vpno, 1);
+	restore(ps);
+	return OK;
+}
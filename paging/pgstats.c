@@ -0,0 +1,94 @@
+/* pgstats.c - pgs_clear, pgs_fault, pgstats, pgdump */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+struct	pgstats	pg_gstats;		/* system-wide totals		*/
+struct	pgstats	pg_pstats[NPROC];	/* charged to each process	*/
+
+LOCAL	void	pgs_print();
+
+/*-------------------------------------------------------------------------
+ * pgs_clear - zero the counters of a new process
+ *-------------------------------------------------------------------------
+ */
+void pgs_clear(int pid)
+{
+	bzero(&pg_pstats[pid], sizeof(struct pgstats));
+}
+
+/*-------------------------------------------------------------------------
+ * pgs_fault - account one page fault of pid that took cycles to serve
+ *-------------------------------------------------------------------------
+ */
+void pgs_fault(int pid, int major, unsigned long long cycles)
+{
+	int	b;
+
+	for (b=0 ; b<PGHBUCKETS-1 && cycles > 1 ; b++)
+		cycles >>= 1;
+	pgs_inc(pid, ps_faults, 1);
+	if (major)
+		pgs_inc(pid, ps_major, 1);
+	else
+		pgs_inc(pid, ps_minor, 1);
+	pgs_inc(pid, ps_hist[b], 1);
+}
+
+/*-------------------------------------------------------------------------
+ * pgstats - copy the paging counters of pid (BADPID: the totals) to psp
+ *-------------------------------------------------------------------------
+ */
+SYSCALL pgstats(int pid, struct pgstats *psp)
+{
+	STATWORD ps;
+
+	if (psp == NULL || (pid != BADPID &&
+	    (isbadpid(pid) || proctab[pid].pstate == PRFREE)))
+		return SYSERR;
+	disable(ps);
+	*psp = (pid == BADPID) ? pg_gstats : pg_pstats[pid];
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * pgdump - print the paging counters, in total and for each process
+ *-------------------------------------------------------------------------
+ */
+void pgdump()
+{
+	STATWORD ps;
+	int	pid;
+
+	disable(ps);
+	kprintf("paging totals:\n");
+	pgs_print(&pg_gstats);
+	for (pid=0 ; pid<NPROC ; pid++)
+		if (proctab[pid].pstate != PRFREE && pg_pstats[pid].ps_faults) {
+			kprintf("pid %d (%s):\n", pid, proctab[pid].pname);
+			pgs_print(&pg_pstats[pid]);
+		}
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * pgs_print - print one set of counters and its latency histogram
+ *-------------------------------------------------------------------------
+ */
+LOCAL void pgs_print(struct pgstats *psp)
+{
+	int	b;
+
+	kprintf("  faults %d (major %d, minor %d)  evictions %d  writebacks %d\n",
+		psp->ps_faults, psp->ps_major, psp->ps_minor,
+		psp->ps_evict, psp->ps_wback);
+	kprintf("  read %u KB  written %u KB  page tables %d  pinned %d\n",
+		psp->ps_rdbytes / 1024, psp->ps_wrbytes / 1024,
+		psp->ps_ptalloc, psp->ps_pinned);
+	for (b=0 ; b<PGHBUCKETS ; b++)
+		if (psp->ps_hist[b])
+			kprintf("  < 2^%d cycles: %d\n", b+1, psp->ps_hist[b]);
+}
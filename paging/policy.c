@@ -1,29 +1,264 @@
-/* policy.c = srpolicy*/
+/* policy.c = srpolicy, grpolicy, pol_insert, pol_remove, pgtick */
 
 #include <conf.h>
 #include <kernel.h>
+#include <proc.h>
 #include <paging.h>
 
+/*
+ * Resident FR_PAGE frames sit on one circular list threaded through
+ * fr_qnext/fr_qprev.  New frames are linked in just behind frm_hand,
+ * so the hand always rests on the oldest page the policy has not yet
+ * passed over.  Each policy only decides how the hand moves and which
+ * frame it gives up.
+ */
+
+LOCAL	int	sc_victim(), fifo_victim(), aging_victim(), ws_victim();
+LOCAL	void	aging_map(), aging_sample(), ws_map(), ws_sample();
+
+struct	pgpolicy pgpolicies[] = {
+	{ SC,		"SC",		sc_victim,	NULL,	NULL,		NULL },
+	{ FIFO,		"FIFO",		fifo_victim,	NULL,	NULL,		NULL },
+	{ AGING,	"AGING",	aging_victim,	aging_map, aging_sample, NULL },
+	{ WSCLOCK,	"WSCLOCK",	ws_victim,	ws_map,	ws_sample,	NULL }
+};
+#define	NPOLICY	(sizeof(pgpolicies) / sizeof(struct pgpolicy))
+
+struct	pgpolicy *pgpolicy = &pgpolicies[0];
+int	frm_hand = FRM_NONE;		/* replacement hand into ring	*/
+LOCAL	int	pgticks = PGSAMPLE;	/* ticks to the next sample	*/
+LOCAL	int	wsticks = WSWINDOW;	/* ticks to the next window	*/
 
 extern int page_replace_policy;
+extern unsigned long ctr1000;
 /*-------------------------------------------------------------------------
- * srpolicy - set page replace policy 
+ * srpolicy - set page replace policy
  *-------------------------------------------------------------------------
  */
 SYSCALL srpolicy(int policy)
 {
-  /* sanity check ! */
-
-  kprintf("To be implemented!\n");
+	STATWORD ps;
+	int	i;
 
-  return OK;
+	for (i=0 ; i<NPOLICY ; i++)
+		if (pgpolicies[i].pp_id == policy)
+			break;
+	if (i >= NPOLICY)
+		return SYSERR;
+	disable(ps);
+	pgpolicy = &pgpolicies[i];
+	page_replace_policy = policy;
+	restore(ps);
+	return OK;
 }
 
 /*-------------------------------------------------------------------------
- * grpolicy - get page replace policy 
+ * grpolicy - get page replace policy
  *-------------------------------------------------------------------------
  */
 SYSCALL grpolicy()
 {
   return page_replace_policy;
 }
+
+/*-------------------------------------------------------------------------
+ * pol_insert - add a newly mapped frame to the resident ring
+ *-------------------------------------------------------------------------
+ */
+void pol_insert(int i)
+{
+	int	prev;
+
+	if (frm_hand == FRM_NONE) {
+		frm_tab[i].fr_qnext = frm_tab[i].fr_qprev = i;
+		frm_hand = i;
+	} else {
+		prev = frm_tab[frm_hand].fr_qprev;
+		frm_tab[i].fr_qprev = prev;
+		frm_tab[i].fr_qnext = frm_hand;
+		frm_tab[prev].fr_qnext = i;
+		frm_tab[frm_hand].fr_qprev = i;
+	}
+	if (pgpolicy->pp_map != NULL)
+		(*pgpolicy->pp_map)(i);
+}
+
+/*-------------------------------------------------------------------------
+ * pol_remove - take a frame off the resident ring
+ *-------------------------------------------------------------------------
+ */
+void pol_remove(int i)
+{
+	fr_map_t *fptr = &frm_tab[i];
+
+	if (pgpolicy->pp_free != NULL)
+		(*pgpolicy->pp_free)(i);
+	if (fptr->fr_qnext == i) {
+		frm_hand = FRM_NONE;
+	} else {
+		frm_tab[fptr->fr_qprev].fr_qnext = fptr->fr_qnext;
+		frm_tab[fptr->fr_qnext].fr_qprev = fptr->fr_qprev;
+		if (frm_hand == i)
+			frm_hand = fptr->fr_qnext;
+	}
+	fptr->fr_qnext = fptr->fr_qprev = FRM_NONE;
+}
+
+/*-------------------------------------------------------------------------
+ * pgtick - clock hook, samples reference bits every PGSAMPLE ticks
+ *	and closes a working-set window every WSWINDOW; the backing
+ *	store device is run every tick
+ *-------------------------------------------------------------------------
+ */
+void pgtick()
+{
+	bsd_tick();
+	if (--wsticks <= 0) {
+		wsticks = WSWINDOW;
+		ws_window();
+	}
+	if (--pgticks > 0)
+		return;
+	pgticks = PGSAMPLE;
+	if (pgpolicy->pp_sample != NULL && frm_hand != FRM_NONE)
+		(*pgpolicy->pp_sample)();
+}
+
+/*-------------------------------------------------------------------------
+ * sc_victim - second chance: sweep the hand, clearing referenced bits
+ *-------------------------------------------------------------------------
+ */
+LOCAL int sc_victim()
+{
+	int	n;
+
+	if (frm_hand == FRM_NONE)
+		return SYSERR;
+	for (n=0 ; n<2*NFRAMES ; n++) {
+		if (frm_evictable(frm_hand) && !frm_testacc(frm_hand, TRUE))
+			break;
+		frm_hand = frm_tab[frm_hand].fr_qnext;
+	}
+	return n < 2*NFRAMES ? frm_hand : SYSERR;
+}
+
+/*-------------------------------------------------------------------------
+ * fifo_victim - evict the page that has been resident longest
+ *-------------------------------------------------------------------------
+ */
+LOCAL int fifo_victim()
+{
+	int	i;
+
+	if ((i = frm_hand) == FRM_NONE)
+		return SYSERR;
+	do {
+		if (frm_evictable(i))
+			return i;
+		i = frm_tab[i].fr_qnext;
+	} while (i != frm_hand);
+	return SYSERR;
+}
+
+/*-------------------------------------------------------------------------
+ * aging_victim - evict the page with the smallest aging counter
+ *-------------------------------------------------------------------------
+ */
+LOCAL int aging_victim()
+{
+	int	i, victim;
+
+	if ((i = frm_hand) == FRM_NONE)
+		return SYSERR;
+	victim = FRM_NONE;
+	do {
+		if (frm_evictable(i) && (victim == FRM_NONE ||
+		    frm_tab[i].fr_age < frm_tab[victim].fr_age))
+			victim = i;
+		i = frm_tab[i].fr_qnext;
+	} while (i != frm_hand);
+	return victim == FRM_NONE ? SYSERR : victim;
+}
+
+LOCAL void aging_map(int i)
+{
+	frm_tab[i].fr_age = 0x80;
+}
+
+/*-------------------------------------------------------------------------
+ * aging_sample - shift each counter right, feeding in the referenced bit
+ *-------------------------------------------------------------------------
+ */
+LOCAL void aging_sample()
+{
+	int	i;
+
+	i = frm_hand;
+	do {
+		frm_tab[i].fr_age >>= 1;
+		if (frm_testacc(i, TRUE))
+			frm_tab[i].fr_age |= 0x80;
+		i = frm_tab[i].fr_qnext;
+	} while (i != frm_hand);
+}
+
+/*-------------------------------------------------------------------------
+ * ws_victim - WSClock: evict a clean page older than WSTAU; otherwise
+ *	the first old dirty page, otherwise the least recently used one
+ *-------------------------------------------------------------------------
+ */
+LOCAL int ws_victim()
+{
+	fr_map_t *fptr;
+	int	i, victim, dirty, lru;
+
+	if ((i = frm_hand) == FRM_NONE)
+		return SYSERR;
+	victim = dirty = lru = FRM_NONE;
+	do {
+		fptr = &frm_tab[i];
+		if (!frm_evictable(i)) {
+			i = fptr->fr_qnext;
+			continue;
+		}
+		if (frm_testacc(i, TRUE)) {
+			fptr->fr_ltime = ctr1000;
+		} else if (ctr1000 - fptr->fr_ltime > WSTAU) {
+			if (!frm_dirty(i)) {
+				victim = i;
+				break;
+			}
+			if (dirty == FRM_NONE)
+				dirty = i;
+		}
+		if (lru == FRM_NONE || fptr->fr_ltime < frm_tab[lru].fr_ltime)
+			lru = i;
+		i = fptr->fr_qnext;
+	} while (i != frm_hand);
+	if (victim == FRM_NONE)
+		victim = (dirty != FRM_NONE) ? dirty : lru;
+	if (victim == FRM_NONE)
+		return SYSERR;
+	return frm_hand = victim;
+}
+
+LOCAL void ws_map(int i)
+{
+	frm_tab[i].fr_ltime = ctr1000;
+}
+
+/*-------------------------------------------------------------------------
+ * ws_sample - stamp referenced pages with the current time
+ *-------------------------------------------------------------------------
+ */
+LOCAL void ws_sample()
+{
+	int	i;
+
+	i = frm_hand;
+	do {
+		if (frm_testacc(i, TRUE))
+			frm_tab[i].fr_ltime = ctr1000;
+		i = frm_tab[i].fr_qnext;
+	} while (i != frm_hand);
+}
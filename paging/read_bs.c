@@ -10,8 +10,33 @@ SYSCALL read_bs(char *dst, bsd_t bs_id, int page) {
   /* fetch page page from map map_id
      and write beginning at dst.
   */
-   void * phy_addr = BACKING_STORE_BASE + bs_id*BACKING_STORE_UNIT_SIZE + page*NBPG;
+   void * phy_addr = bs_addr(bs_id, page);
    bcopy(phy_addr, (void*)dst, NBPG);
+   bsd_submit(1);
+   return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * read_bs_v - read the n pages v describes, with one copy for each run
+ *	of pages that lie next to each other both on the backing region
+ *	and in memory
+ *-------------------------------------------------------------------------
+ */
+SYSCALL read_bs_v(struct bsio *v, int n)
+{
+	char	*src;
+	int	i, k;
+
+	for (i=0 ; i<n ; i += k) {
+		src = bs_addr(v[i].bi_store, v[i].bi_page);
+		for (k=1 ; i+k < n &&
+		     bs_addr(v[i+k].bi_store, v[i+k].bi_page) == src + k*NBPG &&
+		     v[i+k].bi_addr == v[i].bi_addr + k*NBPG ; k++)
+			;
+		bcopy(src, v[i].bi_addr, k*NBPG);
+		bsd_submit(k);
+	}
+	return OK;
 }
 
 
@@ -0,0 +1,131 @@
+/* readahead.c - readahead, ra_reset, xmadvise */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+/*
+ * Each mapping remembers the page a sequential stream would fault on
+ * next.  A fault there is a hit: the window doubles
+ * (up to RAMAX) and that many following pages are paged in with the
+ * faulting one.  Any other fault is a miss and halves the window.
+ */
+LOCAL	void	ra_fill();
+
+/*-------------------------------------------------------------------------
+ * readahead - called after a fault on vpno; map the pages that follow
+ *-------------------------------------------------------------------------
+ */
+void readahead(int pid, int vpno, int store, int pageth)
+{
+	struct	rastate	*ra;
+	int	m;
+
+	if ((m = bsm_find(pid, vpno)) == SYSERR)
+		return;
+	ra = &bsmaps[m].bm_ra;
+
+	switch (ra->ra_advice) {
+	case XM_RANDOM:
+		return;
+	case XM_SEQUENTIAL:
+		ra->ra_win = RAMAX;
+		break;
+	default:
+		if (vpno == ra->ra_next)
+			ra->ra_win = min(RAMAX, max(RAMIN, ra->ra_win * 2));
+		else
+			ra->ra_win /= 2;
+	}
+	ra_fill(m, vpno + 1, ra->ra_win);
+	ra->ra_next = vpno + 1 + ra->ra_win;
+}
+
+/*-------------------------------------------------------------------------
+ * ra_fill - page in up to npages non-resident pages of mapping m from
+ *	vpno on, without dipping into the free frame reserve.  The pages
+ *	are read in batches, BSIOMAX at a time.
+ *-------------------------------------------------------------------------
+ */
+LOCAL void ra_fill(int m, int vpno, int npages)
+{
+	bm_map_t *bmptr = &bsmaps[m];
+	struct	bsio	v[BSIOMAX];
+	pt_t	*pte;
+	int	pid, end, n, i;
+
+	pid = bmptr->bm_pid;
+	end = min(vpno + npages, bmptr->bm_vpno + bmptr->bm_npages);
+	for (n=0 ; vpno < end ; vpno++) {
+		/* a page and its table at most: the reclaimer stays asleep */
+		if (frm_nfree <= frm_lowat + 1)
+			break;
+		pte = pte_lookup(pid, vpno);
+		if (pte != NULL && pte->pt_pres)
+			continue;
+		if ((i = frm_find(bmptr->bm_store, vpno - bmptr->bm_vpno))
+		    != FRM_NONE && frm_tab[i].fr_io)
+			continue;		/* not here yet		*/
+		if (pgin_v(pid, vpno, bmptr->bm_store, vpno - bmptr->bm_vpno,
+			   v, &n) == SYSERR)
+			break;
+		if (n == BSIOMAX) {
+			zs_loadv(v, n);
+			n = 0;
+		}
+	}
+	zs_loadv(v, n);
+}
+
+/*-------------------------------------------------------------------------
+ * ra_reset - forget the access history of mapping m
+ *-------------------------------------------------------------------------
+ */
+void ra_reset(int m)
+{
+	struct	rastate	*ra = &bsmaps[m].bm_ra;
+
+	ra->ra_next = -1;
+	ra->ra_win = 0;
+	ra->ra_advice = XM_NORMAL;
+}
+
+/*-------------------------------------------------------------------------
+ * xmadvise - hint how the pages from vpage on will be used
+ *-------------------------------------------------------------------------
+ */
+SYSCALL xmadvise(int vpage, int npages, int advice)
+{
+	STATWORD ps;
+	int	m, end, i;
+
+	disable(ps);
+	if (npages <= 0 || (m = bsm_find(currpid, vpage)) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	end = min(vpage + npages, bsmaps[m].bm_vpno + bsmaps[m].bm_npages);
+	switch (advice) {
+	case XM_NORMAL:
+	case XM_SEQUENTIAL:
+	case XM_RANDOM:
+		bsmaps[m].bm_ra.ra_advice = advice;
+		break;
+	case XM_WILLNEED:
+		ra_fill(m, vpage, end - vpage);
+		break;
+	case XM_DONTNEED:			/* pinned pages stay	*/
+		for (i = vpage ; i < end ; i++)
+			if (!bm_ispinned(m, i - bsmaps[m].bm_vpno))
+				pgout(currpid, i, TRUE);
+		tlb_shoot(currpid, vpage, end - vpage);
+		break;
+	default:
+		restore(ps);
+		return SYSERR;
+	}
+	bsd_wait();
+	restore(ps);
+	return OK;
+}
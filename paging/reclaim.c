@@ -0,0 +1,57 @@
+/* reclaim.c - pgreclaim, set_frm_watermarks */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+int	rclpid = BADPID;		/* id of the reclaim daemon	*/
+int	rclsem;				/* signalled below frm_lowat	*/
+int	frm_lowat = FRMLOWAT;		/* wake the daemon below this	*/
+int	frm_hiwat = FRMHIWAT;		/* daemon refills up to this	*/
+int	rcl_nwake;			/* background reclaim passes	*/
+int	rcl_npages;			/* pages evicted by the daemon	*/
+
+/*-------------------------------------------------------------------------
+ * pgreclaim - keep a reserve of free frames so faults rarely have to
+ *	run the replacement policy themselves
+ *-------------------------------------------------------------------------
+ */
+PROCESS pgreclaim()
+{
+	STATWORD ps;
+	int	i;
+
+	while (TRUE) {
+		wait(rclsem);
+		rcl_nwake++;
+		while (frm_nfree < frm_hiwat) {
+			disable(ps);
+			if ((i = pgpolicy->pp_victim()) == SYSERR ||
+			    evict_frm(i) == SYSERR) {
+				restore(ps);
+				break;
+			}
+			rcl_npages++;
+			restore(ps);
+			bsd_wait();
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * set_frm_watermarks - tune the free frame reserve
+ *-------------------------------------------------------------------------
+ */
+SYSCALL set_frm_watermarks(int lo, int hi)
+{
+	STATWORD ps;
+
+	if (lo < 0 || hi < lo || hi > NFRAMES)
+		return SYSERR;
+	disable(ps);
+	frm_lowat = lo;
+	frm_hiwat = hi;
+	restore(ps);
+	return OK;
+}
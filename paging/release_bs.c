@@ -6,8 +6,19 @@
 SYSCALL release_bs(bsd_t bs_id) {
 
   /* release the backing store with ID bs_id */
-    kprintf("To be implemented!\n");
-   return OK;
+	STATWORD ps;
+
+	if (bs_id >= NBS)
+		return SYSERR;
+	disable(ps);
+	if (bsm_tab[bs_id].bs_status != BSM_MAPPED ||
+	    bsm_tab[bs_id].bs_nmaps > 0) {
+		restore(ps);
+		return SYSERR;
+	}
+	free_bsm(bs_id);
+	restore(ps);
+	return OK;
 
 }
 
@@ -0,0 +1,298 @@
+/* swap.c - setswap, sw_out, sw_in, sw_free, sw_full */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+/*
+ * With swap on, a dirty page of a private heap store is not written
+ * back to its place in the store when evicted but to a slot of the
+ * swap area at the top of the backing region, and the slot number is
+ * left in the (non-present) page table entry, marked PT_SWAP.  The
+ * entry keeps its hold on the page table while it names a slot.
+ * A private copy-on-write copy has no place in any store, so it goes
+ * to swap whether swap is on or not, and comes back private.
+ *
+ * Swap I/O is clustered both ways.  A page going out takes with it the
+ * dirty, unreferenced swappable pages its process has just above it,
+ * into the slots after its own; slots are handed out next-fit,
+ * preferring a wholly free cluster.  A fault on a swapped page brings
+ * in the rest of its cluster that still belongs to the same process.
+ * Either way a run of slots moves as one device request (sw_copyv).
+ */
+
+LOCAL	unsigned long sw_map[NSWAP/32];	/* slots in use			*/
+LOCAL	int	sw_pid[NSWAP];		/* who a slot belongs to,	*/
+LOCAL	int	sw_vpno[NSWAP];		/*  and at which page		*/
+LOCAL	char	sw_priv[NSWAP];		/* holds a private COW copy?	*/
+LOCAL	int	sw_nused;		/* slots in use			*/
+LOCAL	int	sw_next;		/* where the next search starts	*/
+LOCAL	int	sw_on;			/* evict heap pages to swap?	*/
+
+LOCAL	int	sw_ok(), sw_alloc(), sw_run();
+LOCAL	void	sw_copyv(), sw_map_in();
+
+#define	sw_isused(s)	(sw_map[(s) >> 5] & (1UL << ((s) & 31)))
+#define	sw_setused(s)	(sw_map[(s) >> 5] |= 1UL << ((s) & 31))
+#define	sw_clrused(s)	(sw_map[(s) >> 5] &= ~(1UL << ((s) & 31)))
+
+/*-------------------------------------------------------------------------
+ * setswap - turn swapping of heap pages on or off; slots in use stay
+ *	valid until their pages come back in
+ *-------------------------------------------------------------------------
+ */
+SYSCALL setswap(int on)
+{
+	sw_on = on;
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * sw_out - copy the page in frame i to a swap slot, if it is a dirty
+ *	heap page and swap is on or a private copy; returns the slot or
+ *	SYSERR.  The pages of its process that go with it (see above)
+ *	are evicted here, into the slots that follow.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL sw_out(int i)
+{
+	STATWORD ps;
+	fr_map_t *fptr = &frm_tab[i];
+	struct	bsio	v[SWCLUSTER];
+	int	f[SWCLUSTER];
+	pt_t	*pte;
+	int	s, n, t, j, pid, vpno;
+
+	if (!sw_ok(i))
+		return SYSERR;
+	disable(ps);
+	pid = fptr->fr_pid;
+	f[0] = i;
+	n = 1;
+	for (vpno = fptr->fr_vpno + 1 ; vpno < fptr->fr_vpno + SWCLUSTER ;
+	     vpno++) {
+		if ((pte = pte_lookup(pid, vpno)) == NULL || !pte->pt_pres)
+			continue;
+		j = pte->pt_base - FRAME0;
+		if (j != zero_frm && frm_tab[j].fr_pid == pid &&
+		    frm_tab[j].fr_vpno == vpno && sw_ok(j) &&
+		    frm_evictable(j) && !frm_testacc(j, FALSE) && frm_dirty(j) &&
+		    proctab[pid].prss - n > proctab[pid].pfrmmin)
+			f[n++] = j;
+	}
+	if ((s = sw_alloc(&n)) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	for (t=0 ; t<n ; t++) {
+		v[t].bi_addr = frm_addr(f[t]);
+		v[t].bi_page = s + t;
+		sw_pid[s + t] = pid;
+		sw_vpno[s + t] = frm_tab[f[t]].fr_vpno;
+		sw_priv[s + t] = frm_tab[f[t]].fr_store == FRM_NONE;
+	}
+	sw_copyv(v, n, TRUE);
+	pgs_inc(currpid, ps_wback, n);
+	pgs_inc(currpid, ps_wrbytes, n * NBPG);
+	for (t=1 ; t<n ; t++)
+		frm_unmap(f[t], s + t);
+	restore(ps);
+	return s;
+}
+
+/*-------------------------------------------------------------------------
+ * sw_in - bring in the swapped page pid has at vpno, and the pages of
+ *	pid in the slots after it, up to the end of its cluster
+ *-------------------------------------------------------------------------
+ */
+SYSCALL sw_in(int pid, int vpno)
+{
+	STATWORD ps;
+	struct	bsio	v[SWCLUSTER];
+	int	f[SWCLUSTER];
+	pt_t	*pte[SWCLUSTER];
+	pt_t	*p;
+	int	s, end, n, t;
+
+	disable(ps);
+	p = pte_lookup(pid, vpno);
+	if (p == NULL || p->pt_pres || !(p->pt_avail & PT_SWAP) ||
+	    bsm_find(pid, vpno) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	s = pte_slot(p);
+	end = min(NSWAP, (s / SWCLUSTER + 1) * SWCLUSTER);
+	for (n=0 ; s < end ; s++) {
+		if (n > 0) {
+			if (frm_nfree <= frm_lowat)
+				break;
+			if (!sw_isused(s) || sw_pid[s] != pid)
+				continue;
+			p = pte_lookup(pid, sw_vpno[s]);
+			if (p == NULL || p->pt_pres ||
+			    !(p->pt_avail & PT_SWAP) || pte_slot(p) != s ||
+			    bsm_find(pid, sw_vpno[s]) == SYSERR)
+				continue;
+		}
+		if (get_frm(&f[n]) == SYSERR)
+			break;
+		v[n].bi_addr = frm_addr(f[n]);
+		v[n].bi_page = s;
+		pte[n++] = p;
+	}
+	if (n == 0) {
+		restore(ps);
+		return SYSERR;
+	}
+	sw_copyv(v, n, FALSE);
+	pgs_inc(pid, ps_rdbytes, n * NBPG);
+	for (t=0 ; t<n ; t++)
+		sw_map_in(f[t], v[t].bi_page, pte[t]);
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * sw_free - drop the swapped page pid has at vpno; if wback is set its
+ *	contents go back to the store first, unless it is a private copy
+ *-------------------------------------------------------------------------
+ */
+SYSCALL sw_free(int pid, int vpno, int wback)
+{
+	STATWORD ps;
+	pt_t	*pte;
+	int	s, m;
+
+	disable(ps);
+	pte = pte_lookup(pid, vpno);
+	if (pte == NULL || pte->pt_pres || !(pte->pt_avail & PT_SWAP)) {
+		restore(ps);
+		return SYSERR;
+	}
+	s = pte_slot(pte);
+	if (wback && !sw_priv[s] && (m = bsm_find(pid, vpno)) != SYSERR)
+		zs_store(sw_addr(s), bsmaps[m].bm_store,
+			 vpno - bsmaps[m].bm_vpno);
+	sw_clrused(s);
+	sw_nused--;
+	pte->pt_avail = 0;
+	pte->pt_base = 0;
+	pt_release(pid, vpno);
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * sw_full - is every swap slot in use?
+ *-------------------------------------------------------------------------
+ */
+int sw_full()
+{
+	return sw_nused >= NSWAP;
+}
+
+/*-------------------------------------------------------------------------
+ * sw_ok - may the page in frame i go to swap?
+ *-------------------------------------------------------------------------
+ */
+LOCAL int sw_ok(int i)
+{
+	fr_map_t *fptr = &frm_tab[i];
+
+	return fptr->fr_pid != BADPID && (fptr->fr_store == FRM_NONE ||
+	       (sw_on && bsm_tab[fptr->fr_store].bs_private));
+}
+
+/*-------------------------------------------------------------------------
+ * sw_alloc - take up to *n slots in a row, setting *n to how many: from
+ *	the next slot if they are free, else from a free cluster, else
+ *	any one slot
+ *-------------------------------------------------------------------------
+ */
+LOCAL int sw_alloc(int *n)
+{
+	int	s, c, k;
+
+	if (sw_next < NSWAP && sw_run(sw_next) >= *n) {
+		s = sw_next;
+	} else {
+		s = SYSERR;
+		for (c=0 ; c<NSWAP && s == SYSERR ; c += SWCLUSTER)
+			if (sw_run(c) == SWCLUSTER)
+				s = c;
+		for (c=0 ; c<NSWAP && s == SYSERR ; c++)
+			if (!sw_isused(c))
+				s = c;
+		if (s == SYSERR)
+			return SYSERR;
+		*n = min(*n, sw_run(s));
+	}
+	for (k=0 ; k<*n ; k++)
+		sw_setused(s + k);
+	sw_nused += *n;
+	sw_next = s + *n;
+	return s;
+}
+
+/*-------------------------------------------------------------------------
+ * sw_run - how many slots from s to the end of its cluster are free
+ *-------------------------------------------------------------------------
+ */
+LOCAL int sw_run(int s)
+{
+	int	k, end;
+
+	end = min(NSWAP, (s / SWCLUSTER + 1) * SWCLUSTER);
+	for (k=0 ; s+k < end && !sw_isused(s + k) ; k++)
+		;
+	return k;
+}
+
+/*-------------------------------------------------------------------------
+ * sw_copyv - copy the n pages v describes to (out) or from their slots,
+ *	bi_page; each run of slots in a row is one device request
+ *-------------------------------------------------------------------------
+ */
+LOCAL void sw_copyv(struct bsio *v, int n, int out)
+{
+	int	i, j, k;
+
+	for (i=0 ; i<n ; i += k) {
+		for (k=1 ; i+k < n && v[i+k].bi_page == v[i].bi_page + k ; k++)
+			;
+		for (j=i ; j<i+k ; j++)
+			if (out)
+				bcopy(v[j].bi_addr, sw_addr(v[j].bi_page), NBPG);
+			else
+				bcopy(sw_addr(v[j].bi_page), v[j].bi_addr, NBPG);
+		bsd_submit(k);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * sw_map_in - map frame i, just read from slot s, where pte says; it
+ *	is dirty, as its store copy is stale, and a private copy stays
+ *	out of the store's cache
+ *-------------------------------------------------------------------------
+ */
+LOCAL void sw_map_in(int i, int s, pt_t *pte)
+{
+	int	m, pid, vpno;
+
+	pid = sw_pid[s];
+	vpno = sw_vpno[s];
+	sw_clrused(s);
+	sw_nused--;
+	set_frm(i, pid, vpno, FR_PAGE);
+	if (!sw_priv[s] && (m = bsm_find(pid, vpno)) != SYSERR)
+		frm_setstore(i, bsmaps[m].bm_store, vpno - bsmaps[m].bm_vpno);
+	frm_tab[i].fr_dirty = 1;
+	pte->pt_pres = 1;
+	pte->pt_write = 1;
+	pte->pt_acc = 0;
+	pte->pt_dirty = 0;
+	pte->pt_avail = 0;
+	pte->pt_base = FRAME0 + i;
+}
@@ -9,13 +9,9 @@
 #include <io.h>
 #include <paging.h>
 
-/*
-static unsigned long esp;
-*/
-
-LOCAL	newpid();
 /*------------------------------------------------------------------------
- *  create  -  create a process to start running a procedure
+ *  vcreate  -  create a process with a private virtual heap of hsize
+ *	pages backed by a store of its own
  *------------------------------------------------------------------------
  */
 SYSCALL vcreate(procaddr,ssize,hsize,priority,name,nargs,args)
@@ -28,24 +24,52 @@ SYSCALL vcreate(procaddr,ssize,hsize,priority,name,nargs,args)
 	long	args;			/* arguments (treated like an	*/
 					/* array in the code)		*/
 {
-	kprintf("To be implemented!\n");
-	return OK;
-}
+	STATWORD ps;
+	struct	pentry	*pptr;
+	bs_map_t *bsptr;
+	unsigned long *a;		/* points to list of args	*/
+	int	pid, store;
 
-/*------------------------------------------------------------------------
- * newpid  --  obtain a new (free) process id
- *------------------------------------------------------------------------
- */
-LOCAL	newpid()
-{
-	int	pid;			/* process id to return		*/
-	int	i;
+	if (hsize <= 0 || hsize > NBSPAGES || nargs > VCMAXARGS)
+		return(SYSERR);
+	disable(ps);
+	if (get_bsm(&store) == SYSERR ||
+	    bs_extalloc(store, hsize) == SYSERR) {
+		restore(ps);
+		return(SYSERR);
+	}
+	a = (unsigned long *) &args;
+	pid = create(procaddr, ssize, priority, name, nargs,
+		     a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+	if (pid == SYSERR) {
+		free_bsm(store);
+		restore(ps);
+		return(SYSERR);
+	}
+
+	/* the heap gets a private store; none of its pages is written */
+	bsptr = &bsm_tab[store];
+	bsptr->bs_status = BSM_MAPPED;
+	bsptr->bs_pid = pid;
+	bsptr->bs_private = TRUE;
+	bs_setfresh(store, hsize);
+	if (bsm_map(pid, VHPNO, store, hsize) == SYSERR) {
+		free_bsm(store);
+		kill(pid);
+		restore(ps);
+		return(SYSERR);
+	}
+	pptr = &proctab[pid];
+	pptr->store = store;
+	pptr->vhpno = VHPNO;
+	pptr->vhpnpages = hsize;
 
-	for (i=0 ; i<NPROC ; i++) {	/* check all NPROC slots	*/
-		if ( (pid=nextproc--) <= 0)
-			nextproc = NPROC-1;
-		if (proctab[pid].pstate == PRFREE)
-			return(pid);
+	/* its free lists live in the kernel, so the heap starts untouched */
+	if ((pptr->vheap = vh_create(hsize)) == NULL) {
+		kill(pid);
+		restore(ps);
+		return(SYSERR);
 	}
-	return(SYSERR);
+	restore(ps);
+	return(pid);
 }
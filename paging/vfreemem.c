@@ -4,16 +4,68 @@
 #include <kernel.h>
 #include <mem.h>
 #include <proc.h>
+#include <paging.h>
 
 extern struct pentry proctab[];
 /*------------------------------------------------------------------------
- *  vfreemem  --  free a virtual memory block, returning it to vmemlist
+ *  vfreemem  --  free a virtual memory block, returning it to its run
+ *	or, if it was large, its pages to the heap
  *------------------------------------------------------------------------
  */
 SYSCALL	vfreemem(block, size)
 	struct	mblock	*block;
 	unsigned size;
 {
-	kprintf("To be implemented!\n");
+	STATWORD ps;
+	struct	pentry	*pptr;
+	struct	vheap	*vh;
+	struct	vhpage	*vp;
+	unsigned off;
+	int	p, c, n, *link;
+
+	pptr = &proctab[currpid];
+	if (size==0 || (vh = pptr->vheap) == NULL ||
+	    (unsigned)block < pptr->vhpno * NBPG ||
+	    (unsigned)block + size > (pptr->vhpno + pptr->vhpnpages) * NBPG)
+		return(SYSERR);
+	disable(ps);
+	off = (unsigned)block - pptr->vhpno * NBPG;
+	p = off / NBPG;
+	vp = &vh->vh_pg[p];
+	if (size > NBPG/2) {
+		if (vp->vp_class != VH_LARGE || off % NBPG != 0 ||
+		    vp->vp_npages != (size + NBPG-1) / NBPG) {
+			restore(ps);
+			return(SYSERR);
+		}
+		vh_putpages(vh, p, vp->vp_npages);
+		restore(ps);
+		return(OK);
+	}
+
+	c = vp->vp_class;
+	off %= NBPG;
+	if (c < 0 || size > vh_objsize(c) || off % vh_objsize(c) != 0) {
+		restore(ps);
+		return(SYSERR);
+	}
+	n = off / vh_objsize(c);
+	if (vp->vp_map[n/32] & (1UL << n%32)) {		/* already free	*/
+		restore(ps);
+		return(SYSERR);
+	}
+	vp->vp_map[n/32] |= 1UL << n%32;
+	if (vp->vp_nfree++ == 0) {		/* back on the class list */
+		vp->vp_next = vh->vh_runs[c];
+		vh->vh_runs[c] = p;
+	}
+	if (vp->vp_nfree == NBPG / vh_objsize(c)) {	/* run is empty	*/
+		for (link = &vh->vh_runs[c] ; *link != p ;
+		     link = &vh->vh_pg[*link].vp_next)
+			;
+		*link = vp->vp_next;
+		vh_putpages(vh, p, 1);
+	}
+	restore(ps);
 	return(OK);
 }
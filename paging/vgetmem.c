@@ -9,14 +9,62 @@
 extern struct pentry proctab[];
 /*------------------------------------------------------------------------
  * vgetmem  --  allocate virtual heap storage, returning lowest WORD address
+ *	Up to half a page comes from a run of its size class; more takes
+ *	whole pages.  Only the kernel-side vheap is searched.
  *------------------------------------------------------------------------
  */
 WORD	*vgetmem(nbytes)
 	unsigned nbytes;
 {
+	STATWORD ps;
+	struct	pentry	*pptr;
+	struct	vheap	*vh;
+	struct	vhpage	*vp;
+	int	c, p, w, b, nobj;
 
-	kprintf("To be implemented!\n");
-	return( SYSERR );
-}
-
+	disable(ps);
+	pptr = &proctab[currpid];
+	if (nbytes == 0 || (vh = pptr->vheap) == NULL ||
+	    nbytes > vh->vh_npages * NBPG) {
+		restore(ps);
+		return( (WORD *)SYSERR);
+	}
+	if (nbytes > NBPG/2) {				/* large	*/
+		if ((p = vh_getpages(vh, (nbytes + NBPG-1) / NBPG)) == SYSERR) {
+			restore(ps);
+			return( (WORD *)SYSERR);
+		}
+		vh->vh_pg[p].vp_class = VH_LARGE;
+		restore(ps);
+		return( (WORD *)((pptr->vhpno + p) * NBPG) );
+	}
 
+	for (c=0 ; vh_objsize(c) < nbytes ; c++)
+		;
+	if ((p = vh->vh_runs[c]) == VH_NONE) {		/* a new run	*/
+		if ((p = vh_getpages(vh, 1)) == SYSERR) {
+			restore(ps);
+			return( (WORD *)SYSERR);
+		}
+		vp = &vh->vh_pg[p];
+		vp->vp_class = c;
+		vp->vp_nfree = nobj = NBPG / vh_objsize(c);
+		for (w=0 ; w<VHMAXOBJ/32 ; w++)
+			vp->vp_map[w] = 0;
+		for (b=0 ; b<nobj ; b++)
+			vp->vp_map[b/32] |= 1UL << b%32;
+		vp->vp_next = VH_NONE;
+		vh->vh_runs[c] = p;
+	}
+	vp = &vh->vh_pg[p];
+	for (w=0 ; vp->vp_map[w] == 0 ; w++)
+		;
+	for (b=0 ; !(vp->vp_map[w] & (1UL << b)) ; b++)
+		;
+	vp->vp_map[w] &= ~(1UL << b);
+	if (--vp->vp_nfree == 0)			/* run is full	*/
+		vh->vh_runs[c] = vp->vp_next;
+	restore(ps);
+	return( (WORD *)((pptr->vhpno + p) * NBPG +
+			 (w * 32 + b) * vh_objsize(c)) );
+}
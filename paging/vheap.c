@@ -0,0 +1,104 @@
+/* vheap.c - vh_create, vh_getpages, vh_putpages */
+
+#include <conf.h>
+#include <kernel.h>
+#include <mem.h>
+#include <proc.h>
+#include <paging.h>
+
+/*
+ * A virtual heap is described entirely by a struct vheap in kernel
+ * memory, one struct vhpage per heap page, so that vgetmem and
+ * vfreemem never touch heap pages to find their way and never fault
+ * them in just to search.  Small objects come from runs: pages given
+ * to one size class, with a bitmap of their free objects.  Objects
+ * larger than half a page, and the runs themselves, are spans of whole
+ * pages taken first fit from an address-ordered list of free spans.
+ */
+
+/*-------------------------------------------------------------------------
+ * vh_create - bookkeeping for an empty heap of npages
+ *-------------------------------------------------------------------------
+ */
+struct vheap *vh_create(int npages)
+{
+	struct	vheap	*vh;
+	unsigned size;
+	int	c;
+
+	size = sizeof(struct vheap) + (npages - 1) * sizeof(struct vhpage);
+	if ((vh = (struct vheap *) getmem(size)) == (struct vheap *) SYSERR)
+		return NULL;
+	vh->vh_size = size;
+	vh->vh_npages = npages;
+	for (c=0 ; c<NVHCLASS ; c++)
+		vh->vh_runs[c] = VH_NONE;
+	vh->vh_free = 0;
+	vh->vh_pg[0].vp_class = VH_FREE;
+	vh->vh_pg[0].vp_npages = npages;
+	vh->vh_pg[0].vp_next = VH_NONE;
+	for (c=1 ; c<npages ; c++)
+		vh->vh_pg[c].vp_class = VH_CONT;
+	return vh;
+}
+
+/*-------------------------------------------------------------------------
+ * vh_getpages - take n pages, first fit; returns the first or SYSERR
+ *-------------------------------------------------------------------------
+ */
+int vh_getpages(struct vheap *vh, int n)
+{
+	struct	vhpage	*vp;
+	int	p, *link;
+
+	for (link = &vh->vh_free ; (p = *link) != VH_NONE ;
+	     link = &vp->vp_next) {
+		vp = &vh->vh_pg[p];
+		if (vp->vp_npages < n)
+			continue;
+		if (vp->vp_npages == n) {
+			*link = vp->vp_next;
+		} else {			/* the rest stays free	*/
+			*link = p + n;
+			vh->vh_pg[p+n].vp_class = VH_FREE;
+			vh->vh_pg[p+n].vp_npages = vp->vp_npages - n;
+			vh->vh_pg[p+n].vp_next = vp->vp_next;
+		}
+		vp->vp_npages = n;
+		return p;
+	}
+	return SYSERR;
+}
+
+/*-------------------------------------------------------------------------
+ * vh_putpages - give back the n pages from p, merging with neighbours
+ *-------------------------------------------------------------------------
+ */
+void vh_putpages(struct vheap *vh, int p, int n)
+{
+	struct	vhpage	*vp;
+	int	q, prev, i;
+
+	for (i=1 ; i<n ; i++)
+		vh->vh_pg[p+i].vp_class = VH_CONT;
+	prev = VH_NONE;
+	for (q = vh->vh_free ; q != VH_NONE && q < p ; q = vh->vh_pg[q].vp_next)
+		prev = q;
+	vp = &vh->vh_pg[p];
+	vp->vp_class = VH_FREE;
+	vp->vp_npages = n;
+	vp->vp_next = q;
+	if (q != VH_NONE && p + n == q) {		/* merge with next	*/
+		vp->vp_npages += vh->vh_pg[q].vp_npages;
+		vp->vp_next = vh->vh_pg[q].vp_next;
+		vh->vh_pg[q].vp_class = VH_CONT;
+	}
+	if (prev == VH_NONE) {
+		vh->vh_free = p;
+	} else if (prev + vh->vh_pg[prev].vp_npages == p) { /* and previous */
+		vh->vh_pg[prev].vp_npages += vp->vp_npages;
+		vh->vh_pg[prev].vp_next = vp->vp_next;
+		vp->vp_class = VH_CONT;
+	} else
+		vh->vh_pg[prev].vp_next = p;
+}
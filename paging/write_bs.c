@@ -11,8 +11,30 @@ int write_bs(char *src, bsd_t bs_id, int page) {
      to the backing store bs_id, page
      page.
   */
-   char * phy_addr = BACKING_STORE_BASE + bs_id*BACKING_STORE_UNIT_SIZE + page*NBPG;
+   char * phy_addr = bs_addr(bs_id, page);
    bcopy((void*)src, phy_addr, NBPG);
+   bsd_submit(1);
+   return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * write_bs_v - write the n pages v describes, coalesced as in read_bs_v
+ *-------------------------------------------------------------------------
+ */
+SYSCALL write_bs_v(struct bsio *v, int n)
+{
+	char	*dst;
+	int	i, k;
 
+	for (i=0 ; i<n ; i += k) {
+		dst = bs_addr(v[i].bi_store, v[i].bi_page);
+		for (k=1 ; i+k < n &&
+		     bs_addr(v[i+k].bi_store, v[i+k].bi_page) == dst + k*NBPG &&
+		     v[i+k].bi_addr == v[i].bi_addr + k*NBPG ; k++)
+			;
+		bcopy(v[i].bi_addr, dst, k*NBPG);
+		bsd_submit(k);
+	}
+	return OK;
 }
 
@@ -0,0 +1,148 @@
+/* wss.c - ws_window, frm_trim, getwss, setfrmquota */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <paging.h>
+
+/*
+ * Every WSWINDOW ticks each process's working set is taken to be the
+ * resident pages it referenced during the window, and its fault count
+ * for the window is saved as its fault rate.  A process given a quota
+ * with setfrmquota has its allotment (ptarget) steered by page fault
+ * frequency: many faults grow it toward pfrmmax, few shrink it toward
+ * its working set but never below pfrmmin.  A process at its allotment
+ * replaces its own pages (frm_trim) instead of taking someone else's.
+ */
+
+LOCAL	int	wsnew[NPROC];		/* referenced pages this window	*/
+
+/*-------------------------------------------------------------------------
+ * ws_window - close a working-set window (called from pgtick)
+ *-------------------------------------------------------------------------
+ */
+void ws_window()
+{
+	struct	pentry	*pptr;
+	pt_t	*pte;
+	int	i, m, pid, vpno;
+
+	for (pid=0 ; pid<NPROC ; pid++)
+		wsnew[pid] = 0;
+	if ((i = frm_hand) != FRM_NONE) {
+		do {
+			for (m = BM_NONE ; (pte = frm_pte(i, &m, &pid, &vpno)) != NULL ; ) {
+				if (!pte->pt_acc && !(pte->pt_avail & PT_WSREF))
+					continue;
+				wsnew[pid]++;
+				if (pte->pt_acc) {	/* keep it for the policy */
+					pte->pt_avail |= PT_POLREF;
+					pte->pt_acc = 0;
+					tlb_shoot(pid, vpno, 1);
+				}
+				pte->pt_avail &= ~PT_WSREF;
+			}
+			i = frm_tab[i].fr_qnext;
+		} while (i != frm_hand);
+	}
+
+	for (pid=0 ; pid<NPROC ; pid++) {
+		pptr = &proctab[pid];
+		if (pptr->pstate == PRFREE)
+			continue;
+		pptr->pwss = wsnew[pid];
+		pptr->pfltrate = pptr->pflts;
+		pptr->pflts = 0;
+		if (pptr->pfrmmax >= NFRAMES && pptr->pfrmmin == 0)
+			continue;			/* no quota	*/
+		if (pptr->pfltrate > PFFHI)
+			pptr->ptarget += pptr->pfltrate;
+		else if (pptr->pfltrate < PFFLO)
+			pptr->ptarget = max(pptr->pwss, pptr->ptarget - PFFSTEP);
+		pptr->ptarget = max(pptr->pfrmmin,
+				    min(pptr->pfrmmax, pptr->ptarget));
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * frm_trim - evict one of pid's own pages, the first unreferenced one
+ *	from the hand
+ *-------------------------------------------------------------------------
+ */
+SYSCALL frm_trim(int pid)
+{
+	STATWORD ps;
+	int	i, victim, first;
+
+	disable(ps);
+	victim = first = FRM_NONE;
+	if ((i = frm_hand) != FRM_NONE) {
+		do {
+			if (frm_tab[i].fr_pid == pid && frm_evictable(i)) {
+				if (!frm_testacc(i, TRUE)) {
+					victim = i;
+					break;
+				}
+				if (first == FRM_NONE)
+					first = i;
+			}
+			i = frm_tab[i].fr_qnext;
+		} while (i != frm_hand);
+	}
+	if (victim == FRM_NONE)
+		victim = first;		/* all referenced: the oldest	*/
+	if (victim == FRM_NONE || evict_frm(victim) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * getwss - working-set size of pid over the last window, in pages
+ *-------------------------------------------------------------------------
+ */
+SYSCALL getwss(int pid)
+{
+	if (isbadpid(pid) || proctab[pid].pstate == PRFREE)
+		return SYSERR;
+	return proctab[pid].pwss;
+}
+
+/*-------------------------------------------------------------------------
+ * setfrmquota - keep pid between lo and hi resident frames;
+ *	lo 0 and hi NFRAMES remove the quota
+ *-------------------------------------------------------------------------
+ */
+SYSCALL setfrmquota(int pid, int lo, int hi)
+{
+	STATWORD ps;
+	struct	pentry	*pptr;
+	int	p, total;
+
+	if (isbadpid(pid) || lo < 0 || hi < lo || hi > NFRAMES)
+		return SYSERR;
+	disable(ps);
+	pptr = &proctab[pid];
+	if (pptr->pstate == PRFREE) {
+		restore(ps);
+		return SYSERR;
+	}
+
+	/* guaranteed frames must leave most of memory to everyone else */
+	total = lo;
+	for (p=0 ; p<NPROC ; p++)
+		if (p != pid && proctab[p].pstate != PRFREE)
+			total += proctab[p].pfrmmin;
+	if (total > NFRAMES / 2) {
+		restore(ps);
+		return SYSERR;
+	}
+	pptr->pfrmmin = lo;
+	pptr->pfrmmax = hi;
+	pptr->ptarget = (lo == 0 && hi >= NFRAMES) ? NFRAMES :
+			max(lo, min(hi, max(PFFSTEP, pptr->prss)));
+	restore(ps);
+	return OK;
+}
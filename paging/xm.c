@@ -1,10 +1,10 @@
-/* xm.c = xmmap xmunmap */
+/* xm.c = xmmap xmmap_cow xmunmap xmlock xmunlock */
 
 #include <conf.h>
 #include <kernel.h>
 #include <proc.h>
 #include <paging.h>
-
+LOCAL	int	xm_map(), xm_pin();
 
 /*-------------------------------------------------------------------------
  * xmmap - xmmap
@@ -12,8 +12,40 @@
  */
 SYSCALL xmmap(int virtpage, bsd_t source, int npages)
 {
-  kprintf("xmmap - to be implemented!\n");
-  return SYSERR;
+	return xm_map(virtpage, source, npages, FALSE);
+}
+
+/*-------------------------------------------------------------------------
+ * xmmap_cow - map a store copy-on-write: pages are shared read-only
+ *	with other mappers, and the first write makes a private copy
+ *	that is never written back to the store
+ *-------------------------------------------------------------------------
+ */
+SYSCALL xmmap_cow(int virtpage, bsd_t source, int npages)
+{
+	return xm_map(virtpage, source, npages, TRUE);
+}
+
+/*-------------------------------------------------------------------------
+ * xm_map - common part of xmmap and xmmap_cow
+ *-------------------------------------------------------------------------
+ */
+LOCAL int xm_map(int virtpage, bsd_t source, int npages, int cow)
+{
+	STATWORD ps;
+
+	if (virtpage < NGPT * NPTE || source >= NBS || npages <= 0 ||
+	    npages > NBSPAGES)
+		return SYSERR;
+	disable(ps);
+	if (bsm_tab[source].bs_private ||
+	    bsm_map(currpid, virtpage, source, npages) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	bsmaps[bsm_find(currpid, virtpage)].bm_cow = cow;
+	restore(ps);
+	return OK;
 }
 
 
@@ -24,6 +56,128 @@ SYSCALL xmmap(int virtpage, bsd_t source, int npages)
  */
 SYSCALL xmunmap(int virtpage)
 {
-  kprintf("To be implemented!");
-  return SYSERR;
+	STATWORD ps;
+	int	m;
+
+	disable(ps);
+	if ((m = bsm_find(currpid, virtpage)) == SYSERR ||
+	    bsmaps[m].bm_vpno != virtpage ||
+	    bsm_tab[bsmaps[m].bm_store].bs_private) {
+		restore(ps);
+		return SYSERR;
+	}
+	bsm_unmap(currpid, virtpage, TRUE);
+	bsd_wait();
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * xmlock - make the npages from vpage resident and keep them so: the
+ *	replacement policy skips a pinned frame.  A never-written heap
+ *	page gets a frame of its own first.  Fails if a page is not
+ *	mapped or NFRPIN frames would be pinned, and then drops the pins
+ *	it made (marked in bm_pnew); pages pinned before stay pinned.
+ *-------------------------------------------------------------------------
+ */
+SYSCALL xmlock(int vpage, int npages)
+{
+	STATWORD ps;
+	int	vpno, m, fail;
+
+	if (npages <= 0)
+		return SYSERR;
+	disable(ps);
+	for (vpno = vpage ; vpno < vpage + npages ; vpno++)
+		if (xm_pin(vpno) == SYSERR)
+			break;
+	fail = vpno < vpage + npages;
+	while (--vpno >= vpage) {
+		m = bsm_find(currpid, vpno);
+		if (bm_isnew(m, vpno - bsmaps[m].bm_vpno)) {
+			bm_clrnew(m, vpno - bsmaps[m].bm_vpno);
+			if (fail)
+				xm_unpin(currpid, vpno);
+		}
+	}
+	bsd_wait();
+	restore(ps);
+	return fail ? SYSERR : OK;
+}
+
+/*-------------------------------------------------------------------------
+ * xmunlock - let the replacement policy have the npages from vpage
+ *	again; pages that are not pinned are left alone
+ *-------------------------------------------------------------------------
+ */
+SYSCALL xmunlock(int vpage, int npages)
+{
+	STATWORD ps;
+	int	vpno;
+
+	if (npages < 0)
+		return SYSERR;
+	disable(ps);
+	for (vpno = vpage ; vpno < vpage + npages ; vpno++)
+		xm_unpin(currpid, vpno);
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * xm_pin - bring in the page of currpid at vpno and pin its frame, once
+ *	for each mapping.  A copy-on-write page's pin moves to the
+ *	private copy its first write makes.
+ *-------------------------------------------------------------------------
+ */
+LOCAL int xm_pin(int vpno)
+{
+	pt_t	*pte;
+	int	m, store, pageth;
+
+	if ((m = bsm_find(currpid, vpno)) == SYSERR)
+		return SYSERR;
+	store = bsmaps[m].bm_store;
+	pageth = vpno - bsmaps[m].bm_vpno;
+	if (bm_ispinned(m, pageth))
+		return OK;
+	if ((bs_isfresh(store, pageth) ?
+	     zfill(currpid, vpno, store, pageth) :
+	     pgin(currpid, vpno, store, pageth)) == SYSERR)
+		return SYSERR;
+	if ((pte = pte_lookup(currpid, vpno)) == NULL || !pte->pt_pres ||
+	    frm_pin(pte->pt_base - FRAME0) == SYSERR)
+		return SYSERR;
+	bm_setpin(m, pageth);
+	bm_setnew(m, pageth);
+	pgs_inc(currpid, ps_pinned, 1);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * xm_unpin - drop the pin pid's mapping holds on the page at vpno
+ *-------------------------------------------------------------------------
+ */
+SYSCALL xm_unpin(int pid, int vpno)
+{
+	STATWORD ps;
+	pt_t	*pte;
+	int	m, pageth;
+
+	disable(ps);
+	if ((m = bsm_find(pid, vpno)) == SYSERR) {
+		restore(ps);
+		return SYSERR;
+	}
+	pageth = vpno - bsmaps[m].bm_vpno;
+	if (!bm_ispinned(m, pageth)) {
+		restore(ps);
+		return SYSERR;
+	}
+	bm_clrpin(m, pageth);
+	if ((pte = pte_lookup(pid, vpno)) != NULL && pte->pt_pres)
+		frm_unpin(pte->pt_base - FRAME0);
+	pgs_inc(pid, ps_pinned, -1);
+	restore(ps);
+	return OK;
 }
@@ -0,0 +1,446 @@
+/* zswap.c - zs_load[v], zs_store[v], zs_inval, set_zpool, zs_stats */
+
+#include <conf.h>
+#include <kernel.h>
+#include <mem.h>
+#include <proc.h>
+#include <paging.h>
+
+/*
+ * A compressed copy of a store page, once made, is the authoritative
+ * one: loads are served from it and the page on the backing store is
+ * stale until the entry is written back.  Same-filled pages need only
+ * the fill word; other pages are LZ compressed into a first-fit pool
+ * carved from the kernel heap.  When the pool is full the oldest
+ * entries are decompressed and written to the store to make room.
+ */
+
+#define	ZS_NONE		0		/* page lives on the store	*/
+#define	ZS_SAME		1		/* every word equals ze_fill	*/
+#define	ZS_LZ		2		/* ze_len bytes at ze_data	*/
+
+struct	zsent	{
+	int	ze_kind;		/* ZS_NONE, ZS_SAME, ZS_LZ	*/
+	int	ze_len;			/* compressed length		*/
+	unsigned long ze_fill;		/* fill word (ZS_SAME)		*/
+	char	*ze_data;		/* compressed page (ZS_LZ)	*/
+	int	ze_next;		/* pool FIFO, oldest first	*/
+	int	ze_prev;
+};
+
+LOCAL	struct	zsent	zs_tab[NBS*NBSPAGES];
+LOCAL	int	zs_head = FRM_NONE;	/* oldest ZS_LZ entry		*/
+LOCAL	int	zs_tail = FRM_NONE;
+LOCAL	char	*zpool;			/* pool memory, or NULL		*/
+LOCAL	struct	mblock	zplist;		/* free blocks in the pool	*/
+LOCAL	struct	zsstat	zs;		/* counters for zs_stats	*/
+
+LOCAL	unsigned char	zbuf[NBPG];	/* compressor output		*/
+LOCAL	unsigned char	zpage[NBPG];	/* page being written back	*/
+LOCAL	unsigned short	zhash[1 << ZHBITS]; /* position + 1 by hash	*/
+
+LOCAL	int	lz_compress(), lz_decompress(), zs_get(), zs_put();
+LOCAL	char	*zp_alloc();
+LOCAL	void	zp_release(), zs_drop(), zs_wback();
+
+#define	zs_ent(s, p)	(&zs_tab[(s) * NBSPAGES + (p)])
+
+/*-------------------------------------------------------------------------
+ * zs_load - fill dst with page pageth of store, from the pool if we can
+ *-------------------------------------------------------------------------
+ */
+SYSCALL zs_load(char *dst, int store, int pageth)
+{
+	STATWORD ps;
+
+	disable(ps);
+	if (!zs_get(dst, store, pageth)) {
+		read_bs(dst, store, pageth);
+		pgs_inc(currpid, ps_rdbytes, NBPG);
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_loadv - zs_load the n pages v describes; those not in the pool
+ *	are read from the stores together
+ *-------------------------------------------------------------------------
+ */
+SYSCALL zs_loadv(struct bsio *v, int n)
+{
+	STATWORD ps;
+	struct	bsio	rd[BSIOMAX];
+	int	i, nrd;
+
+	disable(ps);
+	for (i=nrd=0 ; i<n ; i++) {
+		if (zs_get(v[i].bi_addr, v[i].bi_store, v[i].bi_page))
+			continue;
+		rd[nrd++] = v[i];
+		if (nrd == BSIOMAX) {
+			read_bs_v(rd, nrd);
+			pgs_inc(currpid, ps_rdbytes, nrd * NBPG);
+			nrd = 0;
+		}
+	}
+	if (nrd > 0) {
+		read_bs_v(rd, nrd);
+		pgs_inc(currpid, ps_rdbytes, nrd * NBPG);
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_store - save page pageth of store from src, compressed if possible
+ *-------------------------------------------------------------------------
+ */
+SYSCALL zs_store(char *src, int store, int pageth)
+{
+	STATWORD ps;
+
+	disable(ps);
+	if (!zs_put(src, store, pageth)) {
+		write_bs(src, store, pageth);
+		pgs_inc(currpid, ps_wrbytes, NBPG);
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_storev - zs_store the n pages v describes; those the pool will not
+ *	take are written to the stores together
+ *-------------------------------------------------------------------------
+ */
+SYSCALL zs_storev(struct bsio *v, int n)
+{
+	STATWORD ps;
+	struct	bsio	wr[BSIOMAX];
+	int	i, nwr;
+
+	disable(ps);
+	for (i=nwr=0 ; i<n ; i++) {
+		if (zs_put(v[i].bi_addr, v[i].bi_store, v[i].bi_page))
+			continue;
+		wr[nwr++] = v[i];
+		if (nwr == BSIOMAX) {
+			write_bs_v(wr, nwr);
+			pgs_inc(currpid, ps_wrbytes, nwr * NBPG);
+			nwr = 0;
+		}
+	}
+	if (nwr > 0) {
+		write_bs_v(wr, nwr);
+		pgs_inc(currpid, ps_wrbytes, nwr * NBPG);
+	}
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_inval - forget every cached page of store (the store is freed)
+ *-------------------------------------------------------------------------
+ */
+void zs_inval(int store)
+{
+	STATWORD ps;
+	int	i;
+
+	disable(ps);
+	for (i=0 ; i<NBSPAGES ; i++)
+		zs_drop(zs_ent(store, i));
+	restore(ps);
+}
+
+/*-------------------------------------------------------------------------
+ * set_zpool - resize the compressed pool to nbytes (0 turns it off);
+ *	what it holds now is written back to the stores first
+ *-------------------------------------------------------------------------
+ */
+SYSCALL set_zpool(unsigned nbytes)
+{
+	STATWORD ps;
+
+	disable(ps);
+	while (zs_head != FRM_NONE)
+		zs_wback(&zs_tab[zs_head]);
+	if (zpool != NULL)
+		freemem((struct mblock *) zpool, zs.zs_size);
+	zpool = NULL;
+	zplist.mnext = NULL;
+	zs.zs_size = 0;
+	nbytes = (unsigned) truncmb(nbytes);
+	if (nbytes == 0) {
+		restore(ps);
+		return OK;
+	}
+	if ((zpool = (char *) getmem(nbytes)) == (char *) SYSERR) {
+		zpool = NULL;
+		restore(ps);
+		return SYSERR;
+	}
+	zplist.mnext = (struct mblock *) zpool;
+	zplist.mnext->mnext = NULL;
+	zplist.mnext->mlen = nbytes;
+	zs.zs_size = nbytes;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_stats - report pool use, hit rate and compression counters
+ *-------------------------------------------------------------------------
+ */
+SYSCALL zs_stats(struct zsstat *zsp)
+{
+	STATWORD ps;
+
+	if (zsp == NULL)
+		return SYSERR;
+	disable(ps);
+	*zsp = zs;
+	restore(ps);
+	return OK;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_get - fill dst from the pool; FALSE if the page lives on the store
+ *-------------------------------------------------------------------------
+ */
+LOCAL int zs_get(char *dst, int store, int pageth)
+{
+	struct	zsent	*ep;
+	unsigned long *wp;
+	int	i;
+
+	ep = zs_ent(store, pageth);
+	zs.zs_loads++;
+	switch (ep->ze_kind) {
+	case ZS_SAME:
+		wp = (unsigned long *) dst;
+		for (i=0 ; i<NBPG/sizeof(long) ; i++)
+			wp[i] = ep->ze_fill;
+		break;
+	case ZS_LZ:
+		lz_decompress(ep->ze_data, ep->ze_len, dst);
+		break;
+	default:
+		return FALSE;
+	}
+	zs.zs_hits++;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_put - keep src in the pool; FALSE if it must go to the store
+ *-------------------------------------------------------------------------
+ */
+LOCAL int zs_put(char *src, int store, int pageth)
+{
+	struct	zsent	*ep;
+	unsigned long *wp;
+	char	*p;
+	int	i, n;
+
+	ep = zs_ent(store, pageth);
+	zs_drop(ep);
+	zs.zs_stores++;
+
+	wp = (unsigned long *) src;
+	for (i=1 ; i<NBPG/sizeof(long) ; i++)
+		if (wp[i] != wp[0])
+			break;
+	if (i == NBPG/sizeof(long)) {
+		ep->ze_kind = ZS_SAME;
+		ep->ze_fill = wp[0];
+		zs.zs_same++;
+		return TRUE;
+	}
+
+	p = NULL;
+	if (zpool != NULL &&
+	    (n = lz_compress(src, zbuf, ZSMAXLEN)) != SYSERR) {
+		while ((p = zp_alloc(n)) == NULL && zs_head != FRM_NONE)
+			zs_wback(&zs_tab[zs_head]);
+	}
+	if (p == NULL) {			/* incompressible	*/
+		zs.zs_rejects++;
+		return FALSE;
+	}
+	bcopy(zbuf, p, n);
+	ep->ze_kind = ZS_LZ;
+	ep->ze_len = n;
+	ep->ze_data = p;
+	ep->ze_next = FRM_NONE;
+	ep->ze_prev = zs_tail;
+	if (zs_tail == FRM_NONE)
+		zs_head = ep - zs_tab;
+	else
+		zs_tab[zs_tail].ze_next = ep - zs_tab;
+	zs_tail = ep - zs_tab;
+	zs.zs_npages++;
+	zs.zs_used += (unsigned) roundmb(n);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_drop - discard a cached page
+ *-------------------------------------------------------------------------
+ */
+LOCAL void zs_drop(struct zsent *ep)
+{
+	if (ep->ze_kind == ZS_LZ) {
+		if (ep->ze_prev == FRM_NONE)
+			zs_head = ep->ze_next;
+		else
+			zs_tab[ep->ze_prev].ze_next = ep->ze_next;
+		if (ep->ze_next == FRM_NONE)
+			zs_tail = ep->ze_prev;
+		else
+			zs_tab[ep->ze_next].ze_prev = ep->ze_prev;
+		zp_release(ep->ze_data, ep->ze_len);
+		zs.zs_npages--;
+		zs.zs_used -= (unsigned) roundmb(ep->ze_len);
+	}
+	ep->ze_kind = ZS_NONE;
+}
+
+/*-------------------------------------------------------------------------
+ * zs_wback - move a compressed page out to its backing store
+ *-------------------------------------------------------------------------
+ */
+LOCAL void zs_wback(struct zsent *ep)
+{
+	int	i = ep - zs_tab;
+
+	lz_decompress(ep->ze_data, ep->ze_len, zpage);
+	write_bs((char *) zpage, i / NBSPAGES, i % NBSPAGES);
+	pgs_inc(currpid, ps_wrbytes, NBPG);
+	zs_drop(ep);
+	zs.zs_wback++;
+}
+
+/*-------------------------------------------------------------------------
+ * zp_alloc, zp_release - first-fit allocation in the pool, as getmem
+ *-------------------------------------------------------------------------
+ */
+LOCAL char *zp_alloc(unsigned nbytes)
+{
+	struct	mblock	*p, *q, *leftover;
+
+	nbytes = (unsigned) roundmb(nbytes);
+	for (q= &zplist,p=zplist.mnext ; p != NULL ; q=p,p=p->mnext)
+		if (p->mlen == nbytes) {
+			q->mnext = p->mnext;
+			return (char *) p;
+		} else if (p->mlen > nbytes) {
+			leftover = (struct mblock *)((unsigned)p + nbytes);
+			q->mnext = leftover;
+			leftover->mnext = p->mnext;
+			leftover->mlen = p->mlen - nbytes;
+			return (char *) p;
+		}
+	return NULL;
+}
+
+LOCAL void zp_release(char *addr, unsigned size)
+{
+	struct	mblock	*block, *p, *q;
+
+	block = (struct mblock *) addr;
+	size = (unsigned) roundmb(size);
+	for (p=zplist.mnext,q= &zplist ; p != NULL && p < block ;
+	     q=p,p=p->mnext)
+		;
+	if (q != &zplist && (unsigned)q + q->mlen == (unsigned)block)
+		q->mlen += size;
+	else {
+		block->mlen = size;
+		block->mnext = p;
+		q->mnext = block;
+		q = block;
+	}
+	if ((unsigned)q + q->mlen == (unsigned)p) {
+		q->mlen += p->mlen;
+		q->mnext = p->mnext;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * lz_compress - LZ77 a page into dst; SYSERR if it exceeds max bytes.
+ *	A control byte c < 0x80 is followed by c+1 literals; otherwise
+ *	it copies (c & 0x7f) + 3 bytes from a 16-bit offset back.
+ *-------------------------------------------------------------------------
+ */
+LOCAL int lz_compress(unsigned char *src, unsigned char *dst, int max)
+{
+	unsigned long v;
+	int	ip, op, lit, ref, len, n, h;
+
+	for (h=0 ; h<(1 << ZHBITS) ; h++)
+		zhash[h] = 0;
+	ip = op = lit = 0;
+	while (ip <= NBPG - 4) {
+		v = *(unsigned long *)(src + ip);
+		h = (v * 2654435761UL) >> (32 - ZHBITS);
+		ref = zhash[h] - 1;
+		zhash[h] = ip + 1;
+		if (ref < 0 || *(unsigned long *)(src + ref) != v) {
+			ip++;
+			continue;
+		}
+		for (len=4 ; ip+len < NBPG && len < 130 &&
+		     src[ref+len] == src[ip+len] ; len++)
+			;
+		for ( ; lit < ip ; lit += n) {	/* flush literals	*/
+			n = min(ip - lit, 128);
+			if (op + n + 1 > max)
+				return SYSERR;
+			dst[op++] = n - 1;
+			bcopy(src + lit, dst + op, n);
+			op += n;
+		}
+		if (op + 3 > max)
+			return SYSERR;
+		dst[op++] = 0x80 | (len - 3);
+		dst[op++] = (ip - ref) & 0xff;
+		dst[op++] = (ip - ref) >> 8;
+		ip = lit = ip + len;
+	}
+	for ( ; lit < NBPG ; lit += n) {
+		n = min(NBPG - lit, 128);
+		if (op + n + 1 > max)
+			return SYSERR;
+		dst[op++] = n - 1;
+		bcopy(src + lit, dst + op, n);
+		op += n;
+	}
+	return op;
+}
+
+/*-------------------------------------------------------------------------
+ * lz_decompress - expand len bytes made by lz_compress into a page
+ *-------------------------------------------------------------------------
+ */
+LOCAL int lz_decompress(unsigned char *src, int len, unsigned char *dst)
+{
+	int	ip, op, n, off;
+
+	for (ip=op=0 ; ip < len ; ) {
+		n = src[ip++];
+		if (n < 0x80) {
+			bcopy(src + ip, dst + op, ++n);
+			ip += n;
+			op += n;
+		} else {
+			n = (n & 0x7f) + 3;
+			off = src[ip] | (src[ip+1] << 8);
+			ip += 2;
+			for ( ; n > 0 ; n--, op++)
+				dst[op] = dst[op - off];
+		}
+	}
+	return op;
+}
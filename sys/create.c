@@ -44,6 +44,13 @@ SYSCALL create(procaddr,ssize,priority,name,nargs,args)
 		return(SYSERR);
 	}
 
+	pgs_clear(pid);
+	if (pd_alloc(pid) == SYSERR) {
+		freestk(saddr, ssize);
+		restore(ps);
+		return(SYSERR);
+	}
+
 	numproc++;
 	pptr = &proctab[pid];
 
@@ -66,6 +73,12 @@ SYSCALL create(procaddr,ssize,priority,name,nargs,args)
 	pptr->pirmask[0] = 0;
 	pptr->pnxtkin = BADPID;
 	pptr->pdevs[0] = pptr->pdevs[1] = pptr->ppagedev = BADDEV;
+	pptr->store = -1;		/* no virtual heap; see vcreate	*/
+	pptr->vhpno = pptr->vhpnpages = 0;
+	pptr->vheap = NULL;
+	pptr->prss = pptr->pflts = pptr->pfltrate = pptr->pwss = 0;
+	pptr->pfrmmin = 0;
+	pptr->pfrmmax = pptr->ptarget = NFRAMES;
 
 		/* Bottom of stack */
 	*saddr = MAGIC;
@@ -6,41 +6,38 @@
 #include <stdio.h>
 
 /*------------------------------------------------------------------------
- *  freemem  --  free a memory block, returning it to memlist
+ *  freemem  --  free a memory block, merging it with free neighbours
  *------------------------------------------------------------------------
  */
 SYSCALL	freemem(struct mblock *block, unsigned size)
 {
 	STATWORD ps;    
-	struct	mblock	*p, *q;
-	unsigned top;
+	struct	mhead	*h, *p;
+	unsigned len;
 
 	if (size==0 || (unsigned)block>(unsigned)maxaddr
 	    || ((unsigned)block)<((unsigned) &end))
 		return(SYSERR);
-	size = (unsigned)roundmb(size);
+	size = (unsigned)roundmb(size) + MHDR;
+	h = (struct mhead *) ((unsigned)block - MHDR);
 	disable(ps);
-	for( p=memlist.mnext,q= &memlist;
-	     p != (struct mblock *) NULL && p < block ;
-	     q=p,p=p->mnext )
-		;
-	if (((top=q->mlen+(unsigned)q)>(unsigned)block && q!= &memlist) ||
-	    (p!=NULL && (size+(unsigned)block) > (unsigned)p )) {
-		restore(ps);
+	len = mh_len(h);
+	if (!(h->mh_size & MH_USED) || len < size || len >= size + MHMIN) {
+		restore(ps);			/* not what getmem gave	*/
 		return(SYSERR);
 	}
-	if ( q!= &memlist && top == (unsigned)block )
-			q->mlen += size;
-	else {
-		block->mlen = size;
-		block->mnext = p;
-		q->mnext = block;
-		q = block;
+	h->mh_size = len;		/* a second free finds it free	*/
+	p = mh_above(h);
+	if (!(p->mh_size & MH_USED)) {
+		mh_unlink(p);
+		len += p->mh_size;
 	}
-	if ( (unsigned)( q->mlen + (unsigned)q ) == (unsigned)p) {
-		q->mlen += p->mlen;
-		q->mnext = p->mnext;
+	if (h->mh_psize != 0 && !((p = mh_below(h))->mh_size & MH_USED)) {
+		mh_unlink(p);
+		len += p->mh_size;
+		h = p;
 	}
+	mh_link(h, len);
 	restore(ps);
 	return(OK);
 }
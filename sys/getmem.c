@@ -1,4 +1,4 @@
-/* getmem.c - getmem */
+/* getmem.c - getmem, getmemal */
 
 #include <conf.h>
 #include <kernel.h>
@@ -12,29 +12,80 @@
 WORD *getmem(unsigned nbytes)
 {
 	STATWORD ps;    
-	struct	mblock	*p, *q, *leftover;
+	struct	mhead	*h;
+	unsigned need;
+	int	b, c;
 
 	disable(ps);
-	if (nbytes==0 || memlist.mnext== (struct mblock *) NULL) {
+	if (nbytes==0) {
 		restore(ps);
 		return( (WORD *)SYSERR);
 	}
-	nbytes = (unsigned int) roundmb(nbytes);
-	for (q= &memlist,p=memlist.mnext ;
-	     p != (struct mblock *) NULL ;
-	     q=p,p=p->mnext)
-		if ( p->mlen == nbytes) {
-			q->mnext = p->mnext;
-			restore(ps);
-			return( (WORD *)p );
-		} else if ( p->mlen > nbytes ) {
-			leftover = (struct mblock *)( (unsigned)p + nbytes );
-			q->mnext = leftover;
-			leftover->mnext = p->mnext;
-			leftover->mlen = p->mlen - nbytes;
-			restore(ps);
-			return( (WORD *)p );
+	need = (unsigned int) roundmb(nbytes) + MHDR;
+	b = mh_bin(need);
+	h = mbins[b];
+	if (h == (struct mhead *) NULL || h->mh_size < need) {
+		/* any block of a larger class fits; else search this one */
+		for (c=b+1 ; c<NMBIN && !(mbinmap & (1UL << c)) ; c++)
+			;
+		if (c < NMBIN)
+			h = mbins[c];
+		else
+			while (h != (struct mhead *) NULL && h->mh_size < need)
+				h = h->mh_next;
+	}
+	if (h == (struct mhead *) NULL) {
+		restore(ps);
+		return( (WORD *)SYSERR );
+	}
+	h = mh_take(h, need, FALSE);
+	restore(ps);
+	return( (WORD *)((unsigned)h + MHDR) );
+}
+
+/*------------------------------------------------------------------------
+ * getmemal  --  allocate heap storage aligned to align (a power of 2);
+ *		the free space below it stays a free block
+ *------------------------------------------------------------------------
+ */
+WORD *getmemal(unsigned nbytes, unsigned align)
+{
+	STATWORD ps;
+	struct	mhead	*h, *u;
+	unsigned need, lead, len;
+	int	b;
+
+	if (align <= MHDR)
+		return(getmem(nbytes));
+	disable(ps);
+	if (nbytes==0 || (align & (align - 1)) != 0) {
+		restore(ps);
+		return( (WORD *)SYSERR);
+	}
+	need = (unsigned int) roundmb(nbytes) + MHDR;
+	h = (struct mhead *) NULL;
+	for (b=mh_bin(need) ; b<NMBIN && h == (struct mhead *) NULL ; b++)
+		for (h=mbins[b] ; h != (struct mhead *) NULL ; h=h->mh_next) {
+			lead = (((unsigned)h + MHDR + align - 1) & ~(align - 1))
+				- MHDR - (unsigned)h;
+			if (lead != 0 && lead < MHMIN)
+				lead += align;
+			if (lead + need <= h->mh_size)
+				break;
 		}
+	if (h == (struct mhead *) NULL) {
+		restore(ps);
+		return( (WORD *)SYSERR );
+	}
+	if (lead != 0) {		/* free what lies below it	*/
+		mh_unlink(h);
+		len = h->mh_size;
+		mh_link(h, lead);
+		u = mh_above(h);
+		mh_link(u, len - lead);
+		h = u;
+	}
+	h = mh_take(h, need, FALSE);
 	restore(ps);
-	return( (WORD *)SYSERR );
+	return( (WORD *)((unsigned)h + MHDR) );
 }
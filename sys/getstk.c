@@ -12,33 +12,35 @@
 WORD *getstk(unsigned int nbytes)
 {
 	STATWORD ps;    
-	struct	mblock	*p, *q;	/* q follows p along memlist		*/
-	struct	mblock	*fits, *fitsq=NULL;
-	WORD	len;
+	struct	mhead	*h;
+	struct	mhead	*fits;
+	unsigned need;
+	int	b;
 
 	disable(ps);
 	if (nbytes == 0) {
 		restore(ps);
 		return( (WORD *)SYSERR );
 	}
-	nbytes = (unsigned int) roundew(nbytes);
-	fits = (struct mblock *) NULL;
-	q = &memlist;
-	for (p = q->mnext ; p !=(struct mblock *) NULL ; q = p,p = p->mnext)
-		if ( p->mlen >= nbytes) {
-			fitsq = q;
-			fits = p;
-		}
-	if (fits == (struct mblock *) NULL) {
+	nbytes = (unsigned int) roundmb(nbytes);
+	need = nbytes + MHDR;
+	fits = (struct mhead *) NULL;
+	h = mh_below(mtail);		/* the top of memory, if free	*/
+	if (mtail->mh_psize != 0 && !(h->mh_size & MH_USED) &&
+	    h->mh_size >= need)
+		fits = h;
+	else				/* else the highest block that fits */
+		for (b = mh_bin(need) ; b < NMBIN ; b++)
+			for (h = mbins[b] ; h != (struct mhead *) NULL ;
+			     h = h->mh_next)
+				if (h->mh_size >= need && h > fits)
+					fits = h;
+	if (fits == (struct mhead *) NULL) {
 		restore(ps);
 		return( (WORD *)SYSERR );
 	}
-	if (nbytes == (len = fits->mlen) ) {
-		fitsq->mnext = fits->mnext;
-	} else {
-		fits->mlen -= nbytes;
-	}
-	fits = (struct mblock *) ((WORD) fits + len - sizeof(WORD));
+	fits = mh_take(fits, need, TRUE);
+	fits = (struct mhead *) ((WORD) fits + MHDR + nbytes - sizeof(WORD));
 	*((WORD *) fits) = nbytes;
 	restore(ps);
 	return( (WORD *) fits);
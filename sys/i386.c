@@ -140,8 +140,12 @@ setsegs()
 	// maxaddr = (char *)( 1536 * NBPG - 1); /* 10M size */
 	// 			 	      /* the top 10M is used for backing store */
 
-	maxaddr = (char *)( 2048 * NBPG - 1); /* 8M size */
-				 	      /* the top 8M is used for backing store */
+	// maxaddr = (char *)( 2048 * NBPG - 1); /* 8M size */
+	// 			 	      /* the top 8M is used for backing store */
+
+	maxaddr = (char *)( 1024 * NBPG - 1); /* 4M size */
+				 	      /* 4M-8M holds the paging frames, */
+					      /* the top 8M the backing store   */
 						  
 	
 
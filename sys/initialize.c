@@ -32,7 +32,6 @@ int	nextsem;		/* next sempahore slot to use in screate*/
 struct	qent	q[NQENT];	/* q table (see queue.c)		*/
 int	nextqueue;		/* next slot in q structure to use	*/
 char	*maxaddr;		/* max memory address (set by sizmem)	*/
-struct	mblock	memlist;	/* list of free memory blocks		*/
 #ifdef	Ntty
 struct  tty     tty[Ntty];	/* SLU buffers and mode control		*/
 #endif
@@ -131,7 +130,6 @@ sysinit()
 	int	i,j;
 	struct	pentry	*pptr;
 	struct	sentry	*sptr;
-	struct	mblock	*mptr;
 	SYSCALL pfintr();
 
 	
@@ -141,30 +139,13 @@ sysinit()
 	nextsem = NSEM-1;
 	nextqueue = NPROC;		/* q[0..NPROC-1] are processes */
 
-	/* initialize free memory list */
+	/* initialize the heap */
 	/* PC version has to pre-allocate 640K-1024K "hole" */
 	if (maxaddr+1 > HOLESTART) {
-		memlist.mnext = mptr = (struct mblock *) roundmb(&end);
-		mptr->mnext = (struct mblock *)HOLEEND;
-		mptr->mlen = (int) truncew(((unsigned) HOLESTART -
-	     		 (unsigned)&end));
-        mptr->mlen -= 4;
-
-		mptr = (struct mblock *) HOLEEND;
-		mptr->mnext = 0;
-		mptr->mlen = (int) truncew((unsigned)maxaddr - HOLEEND -
-	      		NULLSTK);
-/*
-		mptr->mlen = (int) truncew((unsigned)maxaddr - (4096 - 1024 ) *  4096 - HOLEEND - NULLSTK);
-*/
-	} else {
-		/* initialize free memory list */
-		memlist.mnext = mptr = (struct mblock *) roundmb(&end);
-		mptr->mnext = 0;
-		mptr->mlen = (int) truncew((unsigned)maxaddr - (int)&end -
-			NULLSTK);
-	}
-	
+		mh_init((char *) &end, (char *) HOLESTART - 4);
+		mh_init((char *) HOLEEND, maxaddr - NULLSTK);
+	} else
+		mh_init((char *) &end, maxaddr - NULLSTK);
 
 	for (i=0 ; i<NPROC ; i++)	/* initialize process table */
 		proctab[i].pstate = PRFREE;
@@ -210,6 +191,25 @@ sysinit()
 
 	rdytail = 1 + (rdyhead=newqueue());/* initialize ready list */
 
+	init_frm();			/* initialize frame table	*/
+	init_bsm();			/* initialize backing store map	*/
+	set_zpool(ZPOOLSIZE);		/* compressed page cache	*/
+
+	init_gpt();			/* shared kernel page tables	*/
+	pd_alloc(NULLPROC);		/* turn on paging		*/
+	set_evec(14, (u_long)pfintr);
+	write_cr3(proctab[NULLPROC].pdbr);
+	enable_paging();
+
+	/* paging daemons are not user processes; don't count them	*/
+	cleanpid = create(pgcleaner, MINSTK, CLEANPRIO, "pgcleaner", 0);
+	ready(cleanpid, RESCHNO);
+	numproc--;
+	init_bsdev();			/* backing store device		*/
+	rclsem = screate(0);
+	rclpid = create(pgreclaim, MINSTK, RCLPRIO, "pgreclaim", 0);
+	ready(rclpid, RESCHNO);
+	numproc--;
 
 	return(OK);
 }
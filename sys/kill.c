@@ -8,6 +8,7 @@
 #include <io.h>
 #include <q.h>
 #include <stdio.h>
+#include <paging.h>
 
 /*------------------------------------------------------------------------
  * kill  --  kill a process and remove it from the system
@@ -40,6 +41,14 @@ SYSCALL kill(int pid)
 	send(pptr->pnxtkin, pid);
 
 	freestk(pptr->pbase, pptr->pstklen);
+	frm_teardown(pid);		/* release the address space:	*/
+	bsm_unmapall(pid);		/*  its own pages, then the rest */
+	if (pptr->vheap != NULL) {
+		freemem((struct mblock *) pptr->vheap, pptr->vheap->vh_size);
+		pptr->vheap = NULL;
+	}
+	pd_free(pid);
+	bsd_cancel(pid);		/* owes the device nothing	*/
 	switch (pptr->pstate) {
 
 	case PRCURR:	pptr->pstate = PRFREE;	/* suicide */
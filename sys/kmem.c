@@ -0,0 +1,222 @@
+/* kmem.c - kmem_cache_create, kmem_cache_alloc, kmem_cache_free,
+	    kmem_cache_destroy, kmem_cache_stats */
+
+#include <conf.h>
+#include <kernel.h>
+#include <kmem.h>
+
+/*
+ * A cache hands out objects of one size from slabs, large blocks it
+ * gets from getmemal and carves up itself, so the heap is called only
+ * when every object of every slab is in use.  Free objects are on one
+ * list per cache, linked through a word of their own; allocating and
+ * freeing are a pop and a push.  A slab is kc_slabsz bytes aligned to
+ * its size, so masking an object's address finds its slab head, whose
+ * map marks the free objects: a pointer that is not one of the
+ * cache's objects, or is free already, is turned away.  A constructor
+ * is run once, when its object's slab is made, and objects are to be
+ * freed in the state it leaves them, so then the link word is an
+ * extra one after the object rather than its first.  Slabs go back to
+ * the heap only when the cache is destroyed.
+ */
+
+struct	kmcache	kmtab[NKMCACHE];
+
+#define	kmlink(kcp,obj)	(*(char **)((obj) + (kcp)->kc_link))
+#define	kmslab(kcp,obj)	((struct kmslab *) ((unsigned) (obj) & \
+			 ~((kcp)->kc_slabsz - 1)))
+#define	kmfirst(kcp,slp) ((char *) (slp) + (kcp)->kc_first)
+#define	kmisfree(slp,n)	((slp)->sl_map[(n) >> 5] & (1UL << ((n) & 31)))
+#define	kmsetfree(slp,n) ((slp)->sl_map[(n) >> 5] |= 1UL << ((n) & 31))
+#define	kmclrfree(slp,n) ((slp)->sl_map[(n) >> 5] &= ~(1UL << ((n) & 31)))
+
+LOCAL	int	kmgrow();
+
+/*------------------------------------------------------------------------
+ *  kmem_cache_create  --  make a cache of objects of size bytes, each
+ *		aligned to align (a power of 2, or 0 for a word); returns
+ *		its id
+ *------------------------------------------------------------------------
+ */
+int kmem_cache_create(unsigned int size, unsigned int align,
+		      void (*ctor)(void *))
+{
+	STATWORD ps;
+	struct	kmcache	*kcp;
+	unsigned int	link, first, slabsz;
+	int	cid;
+
+	if (align == 0)
+		align = sizeof(WORD);
+	if (size == 0 || size > KMSLAB || align < sizeof(WORD) ||
+	    align > KMMAXALIGN || (align & (align - 1)) != 0)
+		return(SYSERR);
+	link = ctor != NULL ? (unsigned) roundew(size) : 0;
+	size = max(size, max(link + sizeof(char *), KMMINSIZE));
+	size = (size + align - 1) & ~(align - 1);
+	first = (sizeof(struct kmslab) + align - 1) & ~(align - 1);
+	for (slabsz = KMSLAB ; (slabsz - first) / size < KMMINOBJ ; )
+		slabsz <<= 1;
+	disable(ps);
+	for (cid=0 ; cid<NKMCACHE && kmtab[cid].kc_size != 0 ; cid++)
+		;
+	if (cid == NKMCACHE) {
+		restore(ps);
+		return(SYSERR);
+	}
+	kcp = &kmtab[cid];
+	kcp->kc_size = size;
+	kcp->kc_align = align;
+	kcp->kc_link = link;
+	kcp->kc_slabsz = slabsz;
+	kcp->kc_first = first;
+	kcp->kc_perslab = (slabsz - first) / size;
+	kcp->kc_ctor = ctor;
+	kcp->kc_free = NULL;
+	kcp->kc_slabs = NULL;
+	bzero(&kcp->kc_stat, sizeof(struct kmstat));
+	kcp->kc_stat.ks_size = size;
+	restore(ps);
+	return(cid);
+}
+
+/*------------------------------------------------------------------------
+ *  kmem_cache_alloc  --  take an object from cache cid
+ *------------------------------------------------------------------------
+ */
+void *kmem_cache_alloc(int cid)
+{
+	STATWORD ps;
+	struct	kmcache	*kcp;
+	struct	kmslab	*slp;
+	char	*obj;
+
+	if (cid < 0 || cid >= NKMCACHE || kmtab[cid].kc_size == 0)
+		return((void *) SYSERR);
+	kcp = &kmtab[cid];
+	disable(ps);
+	if (kcp->kc_free == NULL && kmgrow(kcp) == SYSERR) {
+		restore(ps);
+		return((void *) SYSERR);
+	}
+	obj = kcp->kc_free;
+	kcp->kc_free = kmlink(kcp, obj);
+	slp = kmslab(kcp, obj);
+	kmclrfree(slp, (obj - kmfirst(kcp, slp)) / kcp->kc_size);
+	kcp->kc_stat.ks_allocs++;
+	if (++kcp->kc_stat.ks_inuse > kcp->kc_stat.ks_maxused)
+		kcp->kc_stat.ks_maxused = kcp->kc_stat.ks_inuse;
+	restore(ps);
+	return((void *) obj);
+}
+
+/*------------------------------------------------------------------------
+ *  kmem_cache_free  --  give obj back to cache cid; it must be an
+ *		object of the cache that is in use
+ *------------------------------------------------------------------------
+ */
+int kmem_cache_free(int cid, void *obj)
+{
+	STATWORD ps;
+	struct	kmcache	*kcp;
+	struct	kmslab	*slp;
+	unsigned int	off;
+	int	n;
+
+	if (cid < 0 || cid >= NKMCACHE || kmtab[cid].kc_size == 0 ||
+	    (unsigned) obj < (unsigned) &end ||
+	    (unsigned) obj > (unsigned) maxaddr)
+		return(SYSERR);
+	kcp = &kmtab[cid];
+	disable(ps);
+	slp = kmslab(kcp, obj);
+	off = (char *) obj - kmfirst(kcp, slp);
+	n = off / kcp->kc_size;
+	if (slp->sl_cache != kcp || (char *) obj < kmfirst(kcp, slp) ||
+	    off % kcp->kc_size != 0 || n >= kcp->kc_perslab ||
+	    kmisfree(slp, n)) {
+		restore(ps);
+		return(SYSERR);
+	}
+	kmsetfree(slp, n);
+	kmlink(kcp, (char *) obj) = kcp->kc_free;
+	kcp->kc_free = (char *) obj;
+	kcp->kc_stat.ks_frees++;
+	kcp->kc_stat.ks_inuse--;
+	restore(ps);
+	return(OK);
+}
+
+/*------------------------------------------------------------------------
+ *  kmem_cache_destroy  --  give the slabs of cache cid back to the heap;
+ *		none of its objects may be in use
+ *------------------------------------------------------------------------
+ */
+int kmem_cache_destroy(int cid)
+{
+	STATWORD ps;
+	struct	kmcache	*kcp;
+	struct	kmslab	*slp;
+
+	if (cid < 0 || cid >= NKMCACHE || kmtab[cid].kc_size == 0)
+		return(SYSERR);
+	kcp = &kmtab[cid];
+	disable(ps);
+	if (kcp->kc_stat.ks_inuse != 0) {
+		restore(ps);
+		return(SYSERR);
+	}
+	while ((slp = kcp->kc_slabs) != NULL) {
+		kcp->kc_slabs = slp->sl_next;
+		freemem((struct mblock *) slp, kcp->kc_slabsz);
+	}
+	kcp->kc_size = 0;
+	restore(ps);
+	return(OK);
+}
+
+/*------------------------------------------------------------------------
+ *  kmem_cache_stats  --  report the use of cache cid
+ *------------------------------------------------------------------------
+ */
+int kmem_cache_stats(int cid, struct kmstat *ksp)
+{
+	STATWORD ps;
+
+	if (cid < 0 || cid >= NKMCACHE || kmtab[cid].kc_size == 0 ||
+	    ksp == NULL)
+		return(SYSERR);
+	disable(ps);
+	*ksp = kmtab[cid].kc_stat;
+	restore(ps);
+	return(OK);
+}
+
+/*------------------------------------------------------------------------
+ *  kmgrow  --  add a slab of constructed objects to the free list
+ *------------------------------------------------------------------------
+ */
+LOCAL int kmgrow(struct kmcache *kcp)
+{
+	struct	kmslab	*slp;
+	char	*obj;
+	int	i;
+
+	slp = (struct kmslab *) getmemal(kcp->kc_slabsz, kcp->kc_slabsz);
+	if (slp == (struct kmslab *) SYSERR)
+		return(SYSERR);
+	slp->sl_cache = kcp;
+	slp->sl_next = kcp->kc_slabs;
+	kcp->kc_slabs = slp;
+	obj = kmfirst(kcp, slp);
+	for (i=0 ; i<kcp->kc_perslab ; i++, obj += kcp->kc_size) {
+		kmsetfree(slp, i);
+		if (kcp->kc_ctor != NULL)
+			(*kcp->kc_ctor)((void *) obj);
+		kmlink(kcp, obj) = kcp->kc_free;
+		kcp->kc_free = obj;
+	}
+	kcp->kc_stat.ks_slabs++;
+	kcp->kc_stat.ks_total += kcp->kc_perslab;
+	return(OK);
+}
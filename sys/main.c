@@ -8,7 +8,6 @@
 #include <paging.h>
 
 extern char *maxaddr;
-extern struct mblock memlist;
 extern int page_replace_policy;
 extern int initsp;
 
@@ -22,6 +21,8 @@ extern int initsp;
  */
 int main()
 {
+    struct memstat ms;
+
     kprintf("\n\n======== Memory Layout Test ========\n\n");
     
     /* Print memory boundaries */
@@ -55,12 +56,13 @@ int main()
     kprintf("  Available frames: %d frames (%d bytes)\n", 
             1024, 1024 * NBPG);
     
-    /* Print free memory list information */
-    kprintf("\nFree Memory List:\n");
-    kprintf("  First free block address: 0x%08X\n", 
-            (unsigned int)memlist.mnext);
-    kprintf("  First free block size: %d bytes\n", 
-            memlist.mnext ? memlist.mnext->mlen : 0);
+    /* Print kernel heap information */
+    memstat(&ms);
+    kprintf("\nKernel Heap:\n");
+    kprintf("  Free: %d of %d bytes in %d blocks\n", 
+            ms.ms_free, ms.ms_total, ms.ms_nfree);
+    kprintf("  Largest free block: %d bytes (%d%% fragmented)\n", 
+            ms.ms_largest, ms.ms_frag);
     
     /* Print page replacement policy */
     kprintf("\nPage Replacement Policy: %s\n", 
@@ -0,0 +1,151 @@
+/* mheap.c - mh_init, mh_link, mh_unlink, mh_bin, mh_take, memstat */
+
+#include <conf.h>
+#include <kernel.h>
+#include <mem.h>
+
+/*
+ * Every block of the kernel heap, free or in use, starts with a tag
+ * giving its size and that of the block just below it, so a block
+ * being freed finds both neighbours at once and merges with whichever
+ * is free.  Free blocks sit on NMBIN unordered lists, list b holding
+ * the sizes from 2^b up to 2^(b+1); mbinmap tells which are not empty.
+ * A region of memory ends with a tag of size 0 marked in use, which
+ * stops merging; mtail is the one at the top of memory.
+ */
+
+struct	mhead	*mbins[NMBIN];
+unsigned long	mbinmap;
+struct	mhead	*mtail;
+
+LOCAL	unsigned int	mtotal, mfree, mnfree;
+
+/*------------------------------------------------------------------------
+ *  mh_init  --  give the memory from lo up to hi to the heap
+ *------------------------------------------------------------------------
+ */
+void mh_init(char *lo, char *hi)
+{
+	struct	mhead	*h;
+	unsigned int	len;
+
+	h = (struct mhead *) roundmb(lo);
+	len = (unsigned) truncmb(hi) - (unsigned) h - MHDR;
+	h->mh_psize = 0;
+	mtail = (struct mhead *) ((unsigned) h + len);
+	mtail->mh_size = MH_USED;
+	mtotal += len;
+	mh_link(h, len);
+}
+
+/*------------------------------------------------------------------------
+ *  mh_link  --  tag h as a free block of size and put it on its list
+ *------------------------------------------------------------------------
+ */
+void mh_link(struct mhead *h, unsigned int size)
+{
+	int	b;
+
+	h->mh_size = size;
+	mh_above(h)->mh_psize = size;
+	b = mh_bin(size);
+	h->mh_prev = (struct mhead *) NULL;
+	if ((h->mh_next = mbins[b]) != (struct mhead *) NULL)
+		h->mh_next->mh_prev = h;
+	mbins[b] = h;
+	mbinmap |= 1UL << b;
+	mfree += size;
+	mnfree++;
+}
+
+/*------------------------------------------------------------------------
+ *  mh_unlink  --  take the free block h off its list
+ *------------------------------------------------------------------------
+ */
+void mh_unlink(struct mhead *h)
+{
+	int	b;
+
+	b = mh_bin(h->mh_size);
+	if (h->mh_prev != (struct mhead *) NULL)
+		h->mh_prev->mh_next = h->mh_next;
+	else if ((mbins[b] = h->mh_next) == (struct mhead *) NULL)
+		mbinmap &= ~(1UL << b);
+	if (h->mh_next != (struct mhead *) NULL)
+		h->mh_next->mh_prev = h->mh_prev;
+	mfree -= h->mh_size;
+	mnfree--;
+}
+
+/*------------------------------------------------------------------------
+ *  mh_bin  --  the size class of a block of size bytes
+ *------------------------------------------------------------------------
+ */
+int mh_bin(unsigned int size)
+{
+	int	b;
+
+	for (b=0 ; size > 1 ; b++)
+		size >>= 1;
+	return b;
+}
+
+/*------------------------------------------------------------------------
+ *  mh_take  --  use need bytes of the free block h, from its top if top
+ *		is set and its bottom if not; the rest stays free unless
+ *		it is too small to hold a free block
+ *------------------------------------------------------------------------
+ */
+struct mhead *mh_take(struct mhead *h, unsigned int need, int top)
+{
+	struct	mhead	*u;
+	unsigned int	len;
+
+	mh_unlink(h);
+	len = h->mh_size;
+	if (len - need < MHMIN) {
+		h->mh_size = len | MH_USED;
+		return h;
+	}
+	if (top) {
+		mh_link(h, len - need);
+		u = mh_above(h);
+	} else {
+		u = h;
+		u->mh_size = need;
+		mh_link(mh_above(u), len - need);
+	}
+	u->mh_size = need | MH_USED;
+	mh_above(u)->mh_psize = need;
+	return u;
+}
+
+/*------------------------------------------------------------------------
+ *  memstat  --  report free memory, its largest block and fragmentation
+ *------------------------------------------------------------------------
+ */
+SYSCALL	memstat(struct memstat *msp)
+{
+	STATWORD ps;
+	struct	mhead	*h;
+	unsigned int	big;
+	int	b;
+
+	if (msp == (struct memstat *) NULL)
+		return(SYSERR);
+	disable(ps);
+	big = 0;
+	for (b=NMBIN-1 ; b>=0 && !(mbinmap & (1UL << b)) ; b--)
+		;
+	if (b >= 0)				/* the largest is in here */
+		for (h=mbins[b] ; h != (struct mhead *) NULL ; h=h->mh_next)
+			if (h->mh_size > big)
+				big = h->mh_size;
+	msp->ms_total = mtotal;
+	msp->ms_free = mfree;
+	msp->ms_nfree = mnfree;
+	msp->ms_largest = big > MHDR ? big - MHDR : 0;
+	msp->ms_frag = mfree > 0 ? (mfree - big) * 100 / mfree : 0;
+	restore(ps);
+	return(OK);
+}
@@ -4,6 +4,7 @@
 #include <kernel.h>
 #include <proc.h>
 #include <q.h>
+#include <paging.h>
 
 unsigned long currSP;	/* REAL sp of current process */
 
@@ -83,6 +84,7 @@ int	resched()
 	PrintSaved(nptr);
 #endif
 	
+	write_cr3(nptr->pdbr);		/* switch address spaces	*/
 	ctxsw(&optr->pesp, optr->pirmask, &nptr->pesp, nptr->pirmask);
 
 #ifdef	DEBUG
@@ -0,0 +1,36 @@
+/* signalnr.c - signalnr */
+
+#include <conf.h>
+#include <kernel.h>
+#include <proc.h>
+#include <q.h>
+#include <sem.h>
+#include <stdio.h>
+
+/*------------------------------------------------------------------------
+ *  signalnr -- signal a semaphore n times without rescheduling; if a
+ *		released process would get the CPU, the next clock tick
+ *		reschedules (safe from an interrupt handler)
+ *------------------------------------------------------------------------
+ */
+SYSCALL signalnr(int sem, int count)
+{
+	STATWORD ps;
+	struct	sentry	*sptr;
+	int	pid;
+
+	disable(ps);
+	if (isbadsem(sem) || semaph[sem].sstate==SFREE || count<=0) {
+		restore(ps);
+		return(SYSERR);
+	}
+	sptr = &semaph[sem];
+	for (; count > 0  ; count--)
+		if ((sptr->semcnt++) < 0) {
+			ready(pid = getfirst(sptr->sqhead), RESCHNO);
+			if (proctab[pid].pprio >= proctab[currpid].pprio)
+				preempt = 1;
+		}
+	restore(ps);
+	return(OK);
+}
@@ -3,12 +3,14 @@
 #include <proc.h>
 #include <stdio.h>
 #include <paging.h>
+#include <kmem.h>
 
 #define PROC1_VADDR 0x40000000
 #define PROC1_VPNO 0x40000
 #define PROC2_VADDR 0x80000000
 #define PROC2_VPNO 0x80000
 #define TEST1_BS 1
+#define TEST7_BS 2
 
 void proc1_test1(char *msg, int lck)
 {
@@ -76,6 +78,161 @@ void proc1_test3(char *msg, int lck)
 	return;
 }
 
+void proc1_test4(char *msg, int lck)
+{
+	struct kmstat ks;
+	char *obj[20];
+	int cid, i;
+
+	cid = kmem_cache_create(24, 0, NULL);
+	kprintf("cache %d\n", cid);
+	for (i = 0; i < 20; i++)
+	{
+		obj[i] = kmem_cache_alloc(cid);
+	}
+	kmem_cache_stats(cid, &ks);
+	kprintf("size %d slabs %d in use %d\n", ks.ks_size, ks.ks_slabs,
+		ks.ks_inuse);
+
+	kprintf("free inside an object: %d\n",
+		kmem_cache_free(cid, obj[0] + sizeof(WORD)));
+	kprintf("free outside the slabs: %d\n", kmem_cache_free(cid, &ks));
+	for (i = 0; i < 20; i++)
+	{
+		kmem_cache_free(cid, obj[i]);
+	}
+	kprintf("double free: %d\n", kmem_cache_free(cid, obj[0]));
+	kmem_cache_stats(cid, &ks);
+	kprintf("in use %d max %d\n", ks.ks_inuse, ks.ks_maxused);
+	kprintf("destroy: %d\n", kmem_cache_destroy(cid));
+}
+
+void proc1_test5(char *msg, int lck)
+{
+	struct memstat ms0, ms;
+	WORD *a, *b, *c, *stk;
+
+	memstat(&ms0);
+	kprintf("free %d in %d blocks, largest %d, frag %d%%\n",
+		ms0.ms_free, ms0.ms_nfree, ms0.ms_largest, ms0.ms_frag);
+
+	a = getmem(100);
+	b = getmem(100);
+	c = getmem(100);
+	freemem((struct mblock *)a, 100);
+	freemem((struct mblock *)c, 100);
+	memstat(&ms);
+	kprintf("a and c freed: %d blocks\n", ms.ms_nfree);
+	freemem((struct mblock *)b, 100);
+	memstat(&ms);
+	kprintf("b freed, merged both ways: %d blocks, free %d (was %d)\n",
+		ms.ms_nfree, ms.ms_free, ms0.ms_free);
+
+	kprintf("double free: %d\n", freemem((struct mblock *)b, 100));
+	a = getmem(100);
+	kprintf("wrong size: %d\n", freemem((struct mblock *)a, 200));
+	kprintf("right size: %d\n", freemem((struct mblock *)a, 100));
+
+	a = getmem(100);
+	stk = getstk(4096);
+	kprintf("stack at 0x%08x above heap block 0x%08x: %s\n", stk, a,
+		(unsigned)stk > (unsigned)a ? "yes" : "no");
+	freestk(stk, 4096);
+	freemem((struct mblock *)a, 100);
+	memstat(&ms);
+	kprintf("all freed: free %d in %d blocks (were %d in %d)\n",
+		ms.ms_free, ms.ms_nfree, ms0.ms_free, ms0.ms_nfree);
+}
+
+void proc1_test6(char *msg, int lck)
+{
+	char *a, *b, *c, *big;
+
+	a = (char *)vgetmem(10);
+	b = (char *)vgetmem(16);
+	c = (char *)vgetmem(100);
+	big = (char *)vgetmem(3000);
+	*a = 'a';
+	*b = 'b';
+	*c = 'c';
+	*big = 'B';
+	kprintf("16-byte class: 0x%08x 0x%08x\n", a, b);
+	kprintf("128-byte class: 0x%08x\n", c);
+	kprintf("large, page aligned: 0x%08x\n", big);
+	kprintf("values: %c %c %c %c\n", *a, *b, *c, *big);
+
+	vfreemem((struct mblock *)a, 10);
+	kprintf("freed slot reused: %s\n",
+		(char *)vgetmem(16) == a ? "yes" : "no");
+	vfreemem((struct mblock *)b, 16);
+	kprintf("double free: %d\n", vfreemem((struct mblock *)b, 16));
+	kprintf("too big for its class: %d\n", vfreemem((struct mblock *)c, 200));
+	kprintf("large, wrong size: %d\n", vfreemem((struct mblock *)big, 9000));
+	kprintf("large: %d\n", vfreemem((struct mblock *)big, 3000));
+	vfreemem((struct mblock *)a, 16);
+	vfreemem((struct mblock *)c, 100);
+}
+
+void proc1_test7(char *msg, int lck)
+{
+	struct pgstats ps;
+
+	get_bs(TEST7_BS, 16);
+	if (xmmap(PROC1_VPNO, TEST7_BS, 16) == SYSERR)
+	{
+		kprintf("xmmap call failed\n");
+		return;
+	}
+
+	kprintf("lock 0-3: %d\n", xmlock(PROC1_VPNO, 4));
+	kprintf("lock 2-5: %d\n", xmlock(PROC1_VPNO + 2, 4));
+	pgstats(getpid(), &ps);
+	kprintf("pinned %d\n", ps.ps_pinned);
+
+	kprintf("lock 4-19, past the mapping: %d\n",
+		xmlock(PROC1_VPNO + 4, 16));
+	pgstats(getpid(), &ps);
+	kprintf("pinned %d, 4 and 5 kept\n", ps.ps_pinned);
+
+	xmunlock(PROC1_VPNO, 6);
+	pgstats(getpid(), &ps);
+	kprintf("unlocked, pinned %d\n", ps.ps_pinned);
+
+	xmunmap(PROC1_VPNO);
+	release_bs(TEST7_BS);
+}
+
+void proc1_test8(char *msg, int lck)
+{
+	struct pgstats ps;
+	char *addr;
+	int i, bad;
+
+	setswap(1);
+	setfrmquota(getpid(), 0, 8);
+	addr = (char *)vgetmem(40 * NBPG);
+	for (i = 0; i < 40; i++)
+	{
+		*(addr + i * NBPG) = 'A' + i % 26;
+		*(addr + i * NBPG + NBPG - 1) = 'a' + i % 26;
+	}
+
+	bad = 0;
+	for (i = 0; i < 40; i++)
+	{
+		if (*(addr + i * NBPG) != 'A' + i % 26 ||
+		    *(addr + i * NBPG + NBPG - 1) != 'a' + i % 26)
+			bad++;
+	}
+	pgstats(getpid(), &ps);
+	kprintf("40 pages through 8 frames: %d evicted, %d bad\n",
+		ps.ps_evict, bad);
+
+	vfreemem((struct mblock *)addr, 40 * NBPG);
+	setfrmquota(getpid(), 0, NFRAMES);
+	setswap(0);
+}
+
 int main()
 {
 	int pid1;
@@ -96,4 +253,29 @@ int main()
 	pid1 = create(proc1_test3, 2000, 20, "proc1_test3", 0, NULL);
 	resume(pid1);
 	sleep(3);
+
+	kprintf("\n4: kmem caches\n");
+	pid1 = create(proc1_test4, 2000, 20, "proc1_test4", 0, NULL);
+	resume(pid1);
+	sleep(3);
+
+	kprintf("\n5: getmem/freemem/getstk\n");
+	pid1 = create(proc1_test5, 2000, 20, "proc1_test5", 0, NULL);
+	resume(pid1);
+	sleep(3);
+
+	kprintf("\n6: vgetmem size classes\n");
+	pid1 = vcreate(proc1_test6, 2000, 100, 20, "proc1_test6", 0, NULL);
+	resume(pid1);
+	sleep(3);
+
+	kprintf("\n7: xmlock/xmunlock\n");
+	pid1 = create(proc1_test7, 2000, 20, "proc1_test7", 0, NULL);
+	resume(pid1);
+	sleep(3);
+
+	kprintf("\n8: swap round trip\n");
+	pid1 = vcreate(proc1_test8, 2000, 100, 20, "proc1_test8", 0, NULL);
+	resume(pid1);
+	sleep(3);
 }